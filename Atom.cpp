@@ -0,0 +1,149 @@
+#include "Atom.hpp"
+#include <cstring>
+#include <new>
+
+// Buckets allocated by the first intern(); the table doubles when it holds
+// more atoms than buckets
+static const size_t INITIAL_BUCKETS = 64;
+
+Atom::Entry** Atom::_buckets = NULL;
+size_t Atom::_bucketCount = 0;
+size_t Atom::_count = 0;
+
+/**
+ * @brief FNV-1a hash of a string
+ */
+static size_t hashBytes(const char* text, size_t length) {
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(text[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Constructor for Atom, the empty string
+ */
+Atom::Atom() : _entry(NULL) {
+}
+
+Atom::Atom(Entry* entry) : _entry(entry) {
+    if (_entry)
+        ++_entry->refs;
+}
+
+Atom::Atom(const Atom& other) : _entry(other._entry) {
+    if (_entry)
+        ++_entry->refs;
+}
+
+Atom& Atom::operator=(const Atom& other) {
+    if (other._entry)
+        ++other._entry->refs;
+    release();
+    _entry = other._entry;
+    return *this;
+}
+
+/**
+ * @brief Destructor for Atom, frees the entry with its last handle
+ */
+Atom::~Atom() {
+    release();
+}
+
+void Atom::swap(Atom& other) {
+    Entry* entry = _entry;
+    _entry = other._entry;
+    other._entry = entry;
+}
+
+/**
+ * @brief Drop this handle's reference, unlinking the entry if it was the last
+ */
+void Atom::release() {
+    if (!_entry || --_entry->refs > 0)
+        return;
+    Entry** link = &_buckets[_entry->hash & (_bucketCount - 1)];
+    while (*link != _entry)
+        link = &(*link)->next;
+    *link = _entry->next;
+    --_count;
+    ::operator delete(_entry);
+    _entry = NULL;
+}
+
+/**
+ * @brief Find the entry for a string, or NULL
+ */
+Atom::Entry* Atom::lookup(const char* text, size_t length, size_t hash) {
+    if (_bucketCount == 0)
+        return NULL;
+    Entry* entry = _buckets[hash & (_bucketCount - 1)];
+    for (; entry; entry = entry->next) {
+        if (entry->hash == hash && entry->length == length && std::memcmp(text, entry->text, length) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Double the buckets, relinking every entry
+ */
+void Atom::grow() {
+    size_t count = _bucketCount ? _bucketCount * 2 : INITIAL_BUCKETS;
+    Entry** buckets = new Entry*[count];
+    for (size_t i = 0; i < count; ++i)
+        buckets[i] = NULL;
+    for (size_t i = 0; i < _bucketCount; ++i) {
+        Entry* entry = _buckets[i];
+        while (entry) {
+            Entry* next = entry->next;
+            Entry*& bucket = buckets[entry->hash & (count - 1)];
+            entry->next = bucket;
+            bucket = entry;
+            entry = next;
+        }
+    }
+    delete[] _buckets;
+    _buckets = buckets;
+    _bucketCount = count;
+}
+
+/**
+ * @brief Get the atom for a string, adding it to the table if it is new
+ */
+Atom Atom::intern(const char* text, size_t length) {
+    if (length == 0)
+        return Atom();
+    size_t hash = hashBytes(text, length);
+    Entry* entry = lookup(text, length, hash);
+    if (entry)
+        return Atom(entry);
+
+    if (_count >= _bucketCount)
+        grow();
+    entry = static_cast<Entry*>(::operator new(offsetof(Entry, text) + length + 1));
+    entry->hash = hash;
+    entry->refs = 0;
+    entry->length = static_cast<unsigned int>(length);
+    std::memcpy(entry->text, text, length);
+    entry->text[length] = '\0';
+    Entry*& bucket = _buckets[hash & (_bucketCount - 1)];
+    entry->next = bucket;
+    bucket = entry;
+    ++_count;
+    return Atom(entry);
+}
+
+Atom Atom::intern(const std::string& text) {
+    return intern(text.data(), text.length());
+}
+
+/**
+ * @brief Number of distinct strings currently interned
+ */
+size_t Atom::count() {
+    return _count;
+}
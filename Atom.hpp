@@ -0,0 +1,69 @@
+#ifndef ATOM_HPP
+#define ATOM_HPP
+
+#include <cstddef>
+#include <string>
+#include "StringRef.hpp"
+
+/**
+ * @brief Interned, reference-counted, immutable string
+ *
+ * Every distinct string is stored once in a server-wide table, so clients
+ * connecting from the same host share one copy of its name, and two atoms are
+ * equal exactly when they point to the same entry. An Atom is a handle:
+ * copying it takes a reference, destroying it drops one, and the entry is
+ * freed when its last handle goes. The empty string is the null atom and
+ * takes no entry.
+ *
+ * Atoms are created, copied and destroyed only on the thread that owns the
+ * IRC state (the hub in multi-threaded mode); the count is not atomic. The
+ * bytes never change, so another thread may read them through a handle it
+ * doesn't copy, as long as the owner keeps it alive.
+ */
+class Atom {
+private:
+    struct Entry {
+        Entry* next;            // Next entry in the same bucket
+        size_t hash;
+        unsigned int refs;
+        unsigned int length;
+        char text[1];           // Bytes follow the header in the same allocation, then a NUL
+    };
+
+    Entry* _entry;              // NULL for the empty string
+
+    // The table; plain pointers, so atoms in objects destroyed at exit (e.g.
+    // in the slab pools) never outlive it
+    static Entry** _buckets;
+    static size_t _bucketCount;     // A power of two, 0 until the first intern()
+    static size_t _count;
+
+    explicit Atom(Entry* entry);
+
+    static Entry* lookup(const char* text, size_t length, size_t hash);
+    static void grow();
+    void release();
+
+public:
+    Atom();
+    Atom(const Atom& other);
+    Atom& operator=(const Atom& other);
+    ~Atom();
+
+    static Atom intern(const char* text, size_t length);
+    static Atom intern(const std::string& text);
+    static size_t count();
+
+    bool empty() const { return _entry == NULL; }
+    const char* data() const { return _entry ? _entry->text : ""; }
+    size_t length() const { return _entry ? _entry->length : 0; }
+    size_t hash() const { return _entry ? _entry->hash : 0; }
+    StringRef ref() const { return StringRef(data(), length()); }
+    std::string str() const { return std::string(data(), length()); }
+    void swap(Atom& other);
+
+    bool operator==(const Atom& other) const { return _entry == other._entry; }
+    bool operator!=(const Atom& other) const { return _entry != other._entry; }
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "CaseMap.hpp"
+
+/**
+ * @brief Build the RFC 1459 lowercase table
+ */
+struct FoldTable {
+    char map[256];
+
+    FoldTable() {
+        for (int c = 0; c < 256; ++c)
+            map[c] = static_cast<char>(c);
+        for (int c = 'A'; c <= 'Z'; ++c)
+            map[c] = static_cast<char>(c - 'A' + 'a');
+        map[static_cast<unsigned char>('[')] = '{';
+        map[static_cast<unsigned char>(']')] = '}';
+        map[static_cast<unsigned char>('\\')] = '|';
+        map[static_cast<unsigned char>('^')] = '~';
+    }
+};
+
+static const FoldTable TABLE;
+
+/**
+ * @brief Fold one character to its RFC 1459 lowercase form
+ */
+char CaseMap::fold(char c) {
+    return TABLE.map[static_cast<unsigned char>(c)];
+}
+
+/**
+ * @brief Fold a whole name (allocates the result; meant for keys that are stored)
+ */
+std::string CaseMap::fold(const std::string& name) {
+    std::string folded(name);
+    for (size_t i = 0; i < folded.length(); ++i)
+        folded[i] = fold(folded[i]);
+    return folded;
+}
+
+/**
+ * @brief FNV-1a hash of the folded name
+ *
+ * Names that differ only by case hash the same, so the hash of a stored
+ * folded key matches the hash of any spelling of it.
+ */
+size_t CaseMap::hash(const char* name, size_t length) {
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(fold(name[i]));
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Compare a name with an already folded key
+ */
+bool CaseMap::equals(const char* name, size_t length, const std::string& folded) {
+    if (length != folded.length())
+        return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (fold(name[i]) != folded[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Compare two names case-insensitively
+ */
+bool CaseMap::equals(const std::string& a, const std::string& b) {
+    if (a.length() != b.length())
+        return false;
+    for (size_t i = 0; i < a.length(); ++i) {
+        if (fold(a[i]) != fold(b[i]))
+            return false;
+    }
+    return true;
+}
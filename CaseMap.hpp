@@ -0,0 +1,26 @@
+#ifndef CASEMAP_HPP
+#define CASEMAP_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief RFC 1459 case mapping for nicknames and channel names
+ *
+ * IRC treats `[]\^` as the uppercase forms of `{}|~`, on top of the ASCII
+ * letters, so "Nick[away]" and "nick{away}" are the same nickname. fold()
+ * maps every byte to its lowercase form through a 256-entry table.
+ *
+ * hash() and equals() fold as they go, so a name received from the network
+ * can be looked up without building its folded copy first.
+ */
+class CaseMap {
+public:
+    static char fold(char c);
+    static std::string fold(const std::string& name);
+    static size_t hash(const char* name, size_t length);
+    static bool equals(const char* name, size_t length, const std::string& folded);
+    static bool equals(const std::string& a, const std::string& b);
+};
+
+#endif
@@ -10,7 +10,7 @@
  * We initialize all modes to false and user limit to 0.
  */
 Channel::Channel(const std::string& name) 
-    : _name(name), _inviteOnly(false), _topicRestricted(false), 
+    : _name(name), _names(name), _inviteOnly(false), _topicRestricted(false), 
       _hasKey(false), _hasUserLimit(false), _userLimit(0) {
 }
 
@@ -18,11 +18,22 @@ Channel::Channel(const std::string& name)
  * @brief Destructor for Channel class
  */
 Channel::~Channel() {
-    // We don't delete the Client pointers because they're owned by the Server
-    // We just clear our vectors
-    _clients.clear();
-    _operators.clear();
-    _invited.clear();
+    // We don't delete the clients because they're owned by the Server
+}
+
+/**
+ * @brief Get the pool every Channel is allocated from
+ */
+SlabPool<Channel>& Channel::pool() {
+    static SlabPool<Channel> channels;
+    return channels;
+}
+
+/**
+ * @brief Get a generation-checked handle to this channel
+ */
+ChannelHandle Channel::getHandle() const {
+    return pool().handleOf(this);
 }
 
 /**
@@ -51,21 +62,13 @@ const std::string& Channel::getKey() const {
 
 /**
  * @brief Get the list of clients in the channel
- * @return Reference to the clients vector
+ * @return Reference to the members' handles, in no particular order
  * 
- * std::vector<Client*> means a vector that stores pointers to Client objects.
- * Pointers are memory addresses that point to objects.
+ * Handles are resolved with Client::pool().get(), which returns NULL for a
+ * client that no longer exists instead of a dangling pointer.
  */
-const std::vector<Client*>& Channel::getClients() const {
-    return _clients;
-}
-
-/**
- * @brief Get the list of operators in the channel
- * @return Reference to the operators vector
- */
-const std::vector<Client*>& Channel::getOperators() const {
-    return _operators;
+const std::vector<ClientHandle>& Channel::getClients() const {
+    return _members.members();
 }
 
 /**
@@ -112,16 +115,18 @@ bool Channel::hasUserLimit() const {
  * @brief Add a client to the channel
  * @param client Pointer to the client to add
  * 
- * We use push_back() to add elements to the end of a vector.
- * We check if the client is already in the channel to avoid duplicates.
+ * Membership is a mode bit in the member table, so adding a client that is
+ * already a member changes nothing.
  */
 void Channel::addClient(Client* client) {
     if (!hasClient(client)) {
-        _clients.push_back(client);
         // If this is the first client, make them an operator
-        if (_clients.size() == 1) {
-            addOperator(client);
+        unsigned int modes = MemberTable::MODE_MEMBER;
+        if (_members.members().empty()) {
+            modes |= MemberTable::MODE_OP;
         }
+        _members.set(client->getHandle(), modes);
+        listName(client);
     }
 }
 
@@ -129,19 +134,14 @@ void Channel::addClient(Client* client) {
  * @brief Remove a client from the channel
  * @param client Pointer to the client to remove
  * 
- * std::find searches for an element in a container.
- * erase() removes an element from a vector.
- * We also remove them from operators and invited lists.
+ * Dropping every mode bit removes the client's entry, so they also lose
+ * operator status, voice and any pending invite.
  */
 void Channel::removeClient(Client* client) {
-    std::vector<Client*>::iterator it = std::find(_clients.begin(), _clients.end(), client);
-    if (it != _clients.end()) {
-        _clients.erase(it);
-    }
-    
-    // Also remove from operators and invited lists
-    removeOperator(client);
-    removeInvited(client);
+    if (hasClient(client))
+        _names.remove(_members.getChunk(client->getHandle()), client->getHandle());
+    _members.unset(client->getHandle(), MemberTable::MODE_MEMBER | MemberTable::MODE_OP
+                           | MemberTable::MODE_VOICE | MemberTable::MODE_INVITED);
 }
 
 /**
@@ -150,7 +150,7 @@ void Channel::removeClient(Client* client) {
  * @return true if client is in channel, false otherwise
  */
 bool Channel::hasClient(Client* client) const {
-    return std::find(_clients.begin(), _clients.end(), client) != _clients.end();
+    return (_members.get(client->getHandle()) & MemberTable::MODE_MEMBER) != 0;
 }
 
 /**
@@ -158,28 +158,25 @@ bool Channel::hasClient(Client* client) const {
  * @return Number of clients
  */
 size_t Channel::getClientCount() const {
-    return _clients.size();
+    return _members.members().size();
 }
 
 /**
- * @brief Add a client to the operators list
+ * @brief Make a client an operator
  * @param client Pointer to the client to make an operator
  */
 void Channel::addOperator(Client* client) {
-    if (!isOperator(client)) {
-        _operators.push_back(client);
-    }
+    _members.set(client->getHandle(), MemberTable::MODE_OP);
+    relistName(client);
 }
 
 /**
- * @brief Remove a client from the operators list
+ * @brief Take operator status from a client
  * @param client Pointer to the client to remove from operators
  */
 void Channel::removeOperator(Client* client) {
-    std::vector<Client*>::iterator it = std::find(_operators.begin(), _operators.end(), client);
-    if (it != _operators.end()) {
-        _operators.erase(it);
-    }
+    _members.unset(client->getHandle(), MemberTable::MODE_OP);
+    relistName(client);
 }
 
 /**
@@ -188,28 +185,50 @@ void Channel::removeOperator(Client* client) {
  * @return true if client is an operator, false otherwise
  */
 bool Channel::isOperator(Client* client) const {
-    return std::find(_operators.begin(), _operators.end(), client) != _operators.end();
+    return (_members.get(client->getHandle()) & MemberTable::MODE_OP) != 0;
+}
+
+/**
+ * @brief Give voice to a client
+ * @param client Pointer to the client to voice
+ */
+void Channel::addVoice(Client* client) {
+    _members.set(client->getHandle(), MemberTable::MODE_VOICE);
+    relistName(client);
+}
+
+/**
+ * @brief Take voice from a client
+ * @param client Pointer to the client to devoice
+ */
+void Channel::removeVoice(Client* client) {
+    _members.unset(client->getHandle(), MemberTable::MODE_VOICE);
+    relistName(client);
+}
+
+/**
+ * @brief Check if a client is voiced
+ * @param client Pointer to the client to check
+ * @return true if client has voice, false otherwise
+ */
+bool Channel::isVoiced(Client* client) const {
+    return (_members.get(client->getHandle()) & MemberTable::MODE_VOICE) != 0;
 }
 
 /**
- * @brief Add a client to the invited list
+ * @brief Invite a client
  * @param client Pointer to the client to invite
  */
 void Channel::addInvited(Client* client) {
-    if (!isInvited(client)) {
-        _invited.push_back(client);
-    }
+    _members.set(client->getHandle(), MemberTable::MODE_INVITED);
 }
 
 /**
- * @brief Remove a client from the invited list
+ * @brief Cancel a client's invite
  * @param client Pointer to the client to remove from invited list
  */
 void Channel::removeInvited(Client* client) {
-    std::vector<Client*>::iterator it = std::find(_invited.begin(), _invited.end(), client);
-    if (it != _invited.end()) {
-        _invited.erase(it);
-    }
+    _members.unset(client->getHandle(), MemberTable::MODE_INVITED);
 }
 
 /**
@@ -218,7 +237,7 @@ void Channel::removeInvited(Client* client) {
  * @return true if client is invited, false otherwise
  */
 bool Channel::isInvited(Client* client) const {
-    return std::find(_invited.begin(), _invited.end(), client) != _invited.end();
+    return (_members.get(client->getHandle()) & MemberTable::MODE_INVITED) != 0;
 }
 
 /**
@@ -298,25 +317,64 @@ std::string Channel::getModeString() const {
     return modes;
 }
 
+/**
+ * @brief Add a member's name, with its @ or + prefix, to the NAMES cache
+ */
+void Channel::listName(Client* client) {
+    ClientHandle handle = client->getHandle();
+    unsigned int modes = _members.get(handle);
+    std::string name;
+    if (modes & MemberTable::MODE_OP) {
+        name = "@";
+    } else if (modes & MemberTable::MODE_VOICE) {
+        name = "+";
+    }
+    name.append(client->getNickname().data, client->getNickname().length);
+    _members.setChunk(handle, _names.add(handle, name));
+}
+
+/**
+ * @brief Replace a member's name in the NAMES cache (nick or prefix changed)
+ */
+void Channel::relistName(Client* client) {
+    if (!hasClient(client))
+        return;
+    _names.remove(_members.getChunk(client->getHandle()), client->getHandle());
+    listName(client);
+}
+
+/**
+ * @brief Update the NAMES cache after a member changed nickname
+ * @param client The member, already renamed
+ */
+void Channel::updateNickname(Client* client) {
+    relistName(client);
+}
+
 /**
  * @brief Get the list of users for the NAMES command
- * @return String with all usernames, operators prefixed with @
+ * @return String with all nicknames, operators prefixed with @ and voiced users with +
  */
 std::string Channel::getUserList() const {
-    std::string userList;
-    
-    for (size_t i = 0; i < _clients.size(); ++i) {
-        if (i > 0) userList += " ";
-        
-        // Prefix operators with @
-        if (isOperator(_clients[i])) {
-            userList += "@";
-        }
-        
-        userList += _clients[i]->getNickname();
-    }
-    
-    return userList;
+    return _names.list();
+}
+
+/**
+ * @brief Get the number of RPL_NAMREPLY chunks (some may be empty)
+ */
+size_t Channel::getNamesChunkCount() const {
+    return _names.chunkCount();
+}
+
+/**
+ * @brief Get one RPL_NAMREPLY body, ready to be referenced by send queues
+ * @param index Chunk number, below getNamesChunkCount()
+ * @return "= <channel> :<names>\r\n", or NULL if the chunk is empty
+ *
+ * Every line fits in 512 bytes once ":<server> 353 <nick> " is put in front.
+ */
+Payload* Channel::getNamesChunk(size_t index) {
+    return _names.frame(index);
 }
 
 /**
@@ -324,14 +382,18 @@ std::string Channel::getUserList() const {
  * @param message The message to send
  * @param exclude Client to exclude from the broadcast (usually the sender)
  * 
- * This function will be implemented after we create the Utils class
- * for sending messages to clients.
+ * The line is serialized once into a shared Payload; every member's send
+ * queue holds a reference to it, so a big channel costs one allocation and
+ * one copy instead of one per member.
  */
 void Channel::broadcast(const std::string& message, Client* exclude) {
-    for (size_t i = 0; i < _clients.size(); ++i) {
-        if (_clients[i] != exclude) {
-            // We'll implement sendToClient in Utils.cpp
-            Utils::sendToClient(_clients[i], message);
+    const std::vector<ClientHandle>& members = _members.members();
+    Payload* frame = Payload::createLine(message);
+    for (size_t i = 0; i < members.size(); ++i) {
+        Client* client = Client::pool().get(members[i]);
+        if (client != NULL && client != exclude) {
+            Utils::sendToClient(client, frame);
         }
     }
+    frame->release();  // Drop our reference; the queues keep theirs
 }
@@ -2,6 +2,8 @@
 #define CHANNEL_HPP
 
 #include "ircserv.hpp"
+#include "MemberTable.hpp"
+#include "NamesCache.hpp"
 
 /**
  * @brief The Channel class represents an IRC channel
@@ -14,9 +16,8 @@ private:
     std::string _name;                      // Channel name (e.g., "#general")
     std::string _topic;                     // Channel topic
     std::string _key;                       // Channel password (if any)
-    std::vector<Client*> _clients;          // List of clients in the channel
-    std::vector<Client*> _operators;        // List of channel operators
-    std::vector<Client*> _invited;          // List of invited clients (for invite-only mode)
+    MemberTable _members;                   // Members and invited clients, with their modes
+    NamesCache _names;                      // Members' names, split into NAMES replies
     
     // Channel modes
     bool _inviteOnly;                       // +i mode: only invited users can join
@@ -25,19 +26,28 @@ private:
     bool _hasUserLimit;                     // +l mode: channel has user limit
     size_t _userLimit;                      // Maximum number of users
 
-public:
-    // Constructor
+    // Copying would duplicate the member table
+    Channel(const Channel& other);
+    Channel& operator=(const Channel& other);
+
+    void listName(Client* client);
+    void relistName(Client* client);
+
+    // Only the pool constructs and destroys channels
+    friend class SlabPool<Channel>;
     Channel(const std::string& name);
-    
-    // Destructor
     ~Channel();
+
+public:
+    // Channels live in a slab pool: create them with pool().create(name)
+    static SlabPool<Channel>& pool();
+    ChannelHandle getHandle() const;
     
     // Getters
     const std::string& getName() const;
     const std::string& getTopic() const;
     const std::string& getKey() const;
-    const std::vector<Client*>& getClients() const;
-    const std::vector<Client*>& getOperators() const;
+    const std::vector<ClientHandle>& getClients() const;
     size_t getUserLimit() const;
     
     // Mode getters
@@ -57,6 +67,11 @@ public:
     void removeOperator(Client* client);
     bool isOperator(Client* client) const;
     
+    // Voice management
+    void addVoice(Client* client);
+    void removeVoice(Client* client);
+    bool isVoiced(Client* client) const;
+    
     // Invite management
     void addInvited(Client* client);
     void removeInvited(Client* client);
@@ -74,6 +89,9 @@ public:
     // Utility functions
     std::string getModeString() const;      // Returns the channel modes as a string
     std::string getUserList() const;        // Returns list of users for NAMES command
+    size_t getNamesChunkCount() const;      // Number of RPL_NAMREPLY chunks
+    Payload* getNamesChunk(size_t index);   // Cached "= #chan :names\r\n", NULL if empty
+    void updateNickname(Client* client);    // Relist a member after a nick change
     void broadcast(const std::string& message, Client* exclude = NULL);  // Send message to all clients
 };
 
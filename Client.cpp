@@ -9,7 +9,12 @@
  * It initializes all the member variables to their starting values.
  */
 Client::Client(int fd, const std::string& hostname) 
-    : _fd(fd), _hostname(hostname), _authenticated(false), _registered(false), _welcomeSent(false) {
+    : _fd(fd), _sendqExceeded(false), _flushScheduled(false), _writeArmed(false), _attached(false),
+      _released(false), _throttled(false), _readyQueued(false), _liveness(LIVE_REGISTERING),
+      _throttleIndex(0), _readyIndex(0),
+      _sendqLimit(DEFAULT_SENDQ_LIMIT), _listener(NULL), _outbox(NULL), _staged(NULL), _lastInput(0),
+      _hostname(Atom::intern(hostname)), _authenticated(false), _registered(false), _welcomeSent(false),
+      _disconnecting(false) {
     // The : syntax is called "member initializer list"
     // It's more efficient than setting variables inside the constructor body
 }
@@ -26,6 +31,27 @@ Client::~Client() {
     // The socket will be closed by the Server class
 }
 
+/**
+ * @brief Get the pool every Client is allocated from
+ *
+ * Clients are created and destroyed at a high rate (e.g. a reconnect storm
+ * after a netsplit), so they come from fixed-size slabs instead of new/delete.
+ */
+SlabPool<Client>& Client::pool() {
+    static SlabPool<Client> clients;
+    return clients;
+}
+
+/**
+ * @brief Get a generation-checked handle to this client
+ *
+ * Store handles instead of pointers in anything that may outlive the client:
+ * once it is destroyed the handle resolves to NULL.
+ */
+ClientHandle Client::getHandle() const {
+    return pool().handleOf(this);
+}
+
 /**
  * @brief Get the file descriptor
  * @return The socket file descriptor
@@ -39,46 +65,41 @@ int Client::getFd() const {
 
 /**
  * @brief Get the client's nickname
- * @return Reference to the nickname string
+ * @return View of the nickname (valid until the client's strings change)
  * 
- * Returning a const reference (&) is efficient because:
- * 1. We don't copy the string (just return a reference to it)
- * 2. const prevents the caller from modifying our internal data
+ * Returning a view is efficient because:
+ * 1. We don't copy the string (just point into the client's Identity)
+ * 2. The caller can't modify our internal data through it
  */
-const std::string& Client::getNickname() const {
-    return _nickname;
+StringRef Client::getNickname() const {
+    return _identity.get(Identity::NICKNAME);
 }
 
 /**
  * @brief Get the client's username
- * @return Reference to the username string
+ * @return View of the username
  */
-const std::string& Client::getUsername() const {
-    return _username;
+StringRef Client::getUsername() const {
+    return _identity.get(Identity::USERNAME);
 }
 
 /**
  * @brief Get the client's real name
- * @return Reference to the realname string
+ * @return View of the real name
  */
-const std::string& Client::getRealname() const {
-    return _realname;
+StringRef Client::getRealname() const {
+    return _identity.get(Identity::REALNAME);
 }
 
 /**
  * @brief Get the client's hostname
- * @return Reference to the hostname string
+ * @return View of the hostname, valid as long as the client exists
+ *
+ * Unlike the other strings it is set once, at creation, so the Reactor may
+ * read it while the hub changes the client's Identity.
  */
-const std::string& Client::getHostname() const {
-    return _hostname;
-}
-
-/**
- * @brief Get the client's input buffer
- * @return Reference to the buffer string
- */
-const std::string& Client::getBuffer() const {
-    return _buffer;
+StringRef Client::getHostname() const {
+    return _hostname.ref();
 }
 
 /**
@@ -113,7 +134,7 @@ bool Client::isWelcomeSent() const {
  * We take the parameter by const reference to avoid copying.
  */
 void Client::setNickname(const std::string& nickname) {
-    _nickname = nickname;
+    _identity.set(Identity::NICKNAME, nickname.data(), nickname.length());
 }
 
 /**
@@ -121,7 +142,7 @@ void Client::setNickname(const std::string& nickname) {
  * @param username The new username
  */
 void Client::setUsername(const std::string& username) {
-    _username = username;
+    _identity.set(Identity::USERNAME, username.data(), username.length());
 }
 
 /**
@@ -129,7 +150,7 @@ void Client::setUsername(const std::string& username) {
  * @param realname The new real name
  */
 void Client::setRealname(const std::string& realname) {
-    _realname = realname;
+    _identity.set(Identity::REALNAME, realname.data(), realname.length());
 }
 
 /**
@@ -157,30 +178,486 @@ void Client::setWelcomeSent(bool sent) {
 }
 
 /**
- * @brief Add data to the client's input buffer
- * @param data The data to add
+ * @brief Receive data from the client's socket
+ * @return Bytes received, 0 if the client closed the connection, -1 on error
  * 
- * The buffer stores incoming data until we have a complete command.
+ * The data goes straight from the socket into the input buffer, where it
+ * waits until we have a complete command.
  * IRC commands end with \r\n (carriage return + line feed).
  */
-void Client::appendToBuffer(const std::string& data) {
-    _buffer += data;
+ssize_t Client::readInput() {
+    return _input.readFrom(_fd);
+}
+
+/**
+ * @brief Add data received by the event loop to the input buffer
+ * @return Bytes taken (the rest must be offered again once lines are consumed)
+ */
+size_t Client::appendInput(const char* data, size_t length) {
+    return _input.append(data, length);
+}
+
+/**
+ * @brief Get the next complete command line
+ * @param line Set to the line, without \r\n (valid until the next readInput())
+ * @return LINE_OK, LINE_NONE (wait for more data) or LINE_TOO_LONG
+ */
+LineBuffer::Status Client::nextLine(StringRef& line) {
+    return _input.nextLine(line);
+}
+
+/**
+ * @brief Keep the line returned by the last nextLine() for later
+ *
+ * The next nextLine() returns it again; used when a client is throttled.
+ */
+void Client::unreadLine() {
+    _input.unread();
+}
+
+/**
+ * @brief Get the number of received bytes not yet returned as lines
+ */
+size_t Client::getInputSize() const {
+    return _input.size();
+}
+
+/**
+ * @brief Receive into chunks of a pool (that of the Reactor reading the socket)
+ */
+void Client::setInputPool(RecvPool* pool) {
+    _input.setPool(pool);
+}
+
+/**
+ * @brief Drop the buffered input, giving its memory back to the pool
+ *
+ * Called by the Reactor when it is done with the socket: the pool is only
+ * used by its thread, while the Client may be freed by another one.
+ */
+void Client::releaseInput() {
+    _input.clear();
+}
+
+/**
+ * @brief Queue data to be sent to the client
+ * @param data The bytes to send (already terminated with \r\n)
+ * @return true if queued, false if the sendq limit was exceeded
+ *
+ * Nothing is written here: the data waits in the send queue until the event
+ * loop flushes it. If the queue would grow past the sendq limit the data is
+ * dropped and the client is flagged so the server disconnects it.
+ */
+bool Client::queueOutput(const std::string& data) {
+    return queueOutput(data.data(), data.length());
+}
+
+/**
+ * @brief Queue raw bytes to be sent to the client
+ * @param data Pointer to the bytes
+ * @param length Number of bytes
+ * @return true if queued, false if the sendq limit was exceeded
+ */
+bool Client::queueOutput(const char* data, size_t length) {
+    if (_outbox) {
+        Payload* payload = Payload::createCopy(data, length);
+        queueOutput(payload);
+        payload->release();
+        return true;
+    }
+    if (reserveOutput(length))
+        _sendq.append(data, length);
+    return !_sendqExceeded;
+}
+
+/**
+ * @brief Queue a shared payload without copying it
+ * @param payload Sealed payload (e.g. a channel broadcast); we take a reference
+ * @return true if queued, false if the sendq limit was exceeded
+ *
+ * In multi-threaded mode the payload is mailed to the IO thread owning the
+ * socket, which enforces the sendq limit when it delivers it.
+ */
+bool Client::queueOutput(Payload* payload) {
+    if (_outbox) {
+        Mail* mail = new Mail(Mail::MAIL_OUTPUT, this);
+        payload->retain();
+        mail->payload = payload;
+        _outbox->post(mail);
+        return true;
+    }
+    return deliverOutput(payload);
+}
+
+/**
+ * @brief Add a payload to the local send queue
+ * @param payload Sealed payload; we take a reference
+ * @return true if queued, false if the sendq limit was exceeded
+ *
+ * Only the thread running the client's Reactor may call this.
+ */
+bool Client::deliverOutput(Payload* payload) {
+    if (reserveOutput(payload->length()))
+        _sendq.push(payload);
+    return !_sendqExceeded;
+}
+
+/**
+ * @brief Get room for one message, to be formatted in place
+ * @param length Exact number of bytes the caller will write
+ * @return Where to write them, or NULL if the sendq limit was exceeded
+ *
+ * The bytes go straight into the send queue; call commitOutput() once they
+ * are written. In multi-threaded mode they go into a payload that
+ * commitOutput() mails to the IO thread.
+ */
+char* Client::prepareOutput(size_t length) {
+    if (_outbox) {
+        _staged = Payload::createBuffer(length);
+        char* out = _staged->tail();
+        _staged->commit(length);
+        return out;
+    }
+    if (!reserveOutput(length))
+        return NULL;
+    return _sendq.reserve(length);
+}
+
+/**
+ * @brief Finish a message started with prepareOutput()
+ */
+void Client::commitOutput() {
+    if (_staged) {
+        _staged->seal();
+        queueOutput(_staged);
+        _staged->release();
+        _staged = NULL;
+    }
+}
+
+/**
+ * @brief Check the sendq limit before queueing and notify the listener
+ * @param length Number of bytes about to be queued
+ * @return true if the bytes may be queued
+ *
+ * If the queue would grow past the sendq limit the client is flagged so the
+ * server disconnects it, and the queue is freed right away.
+ */
+bool Client::reserveOutput(size_t length) {
+    if (!_sendqExceeded && _sendq.size() + length > _sendqLimit) {
+        _sendqExceeded = true;
+        _sendq.clear();  // The client is going away, free the memory now
+    }
+
+    // Tell the event loop once; it will flush (or disconnect) us
+    if (!_flushScheduled && _listener) {
+        _flushScheduled = true;
+        _listener->onOutputQueued(this);
+    }
+    return !_sendqExceeded;
+}
+
+/**
+ * @brief Write queued output to the socket
+ * @param writes If not NULL, incremented for every system call made
+ * @return Result of the flush (done, retry later or error)
+ */
+SendQueue::FlushResult Client::flushOutput(unsigned long* writes) {
+    return _sendq.flush(_fd, writes);
+}
+
+/**
+ * @brief Describe queued output for a write that completes later
+ * @return Number of iovecs filled (see SendQueue::gather())
+ */
+int Client::gatherOutput(struct iovec* iov, Payload** chunks, int max, size_t* bytes) const {
+    return _sendq.gather(iov, chunks, max, bytes);
+}
+
+/**
+ * @brief Drop output that such a write has sent
+ */
+void Client::consumeOutput(size_t length) {
+    _sendq.consume(length);
+}
+
+/**
+ * @brief Check if there is output waiting to be sent
+ */
+bool Client::hasPendingOutput() const {
+    return !_sendq.empty();
+}
+
+/**
+ * @brief Get the number of bytes waiting to be sent
+ */
+size_t Client::getSendqSize() const {
+    return _sendq.size();
+}
+
+/**
+ * @brief Check if the client exceeded its sendq limit
+ * @return true if the client must be disconnected
+ */
+bool Client::isSendqExceeded() const {
+    return _sendqExceeded;
+}
+
+/**
+ * @brief Set the maximum number of bytes allowed in the send queue
+ */
+void Client::setSendqLimit(size_t limit) {
+    _sendqLimit = limit;
+}
+
+/**
+ * @brief Set the object notified when output is queued
+ */
+void Client::setOutputListener(OutputListener* listener) {
+    _listener = listener;
+}
+
+/**
+ * @brief Route output through the inbox of another thread's Reactor
+ * @param outbox Inbox of the IO thread owning the socket, NULL to queue locally
+ */
+void Client::setOutbox(Mailbox* outbox) {
+    _outbox = outbox;
+}
+
+/**
+ * @brief Get the inbox output is routed through (NULL in single-threaded mode)
+ */
+Mailbox* Client::getOutbox() const {
+    return _outbox;
+}
+
+/**
+ * @brief Check if a Reactor is watching the client's socket
+ */
+bool Client::isAttached() const {
+    return _attached;
+}
+
+/**
+ * @brief Remember whether a Reactor is watching the client's socket
+ */
+void Client::setAttached(bool attached) {
+    _attached = attached;
+}
+
+/**
+ * @brief Check if the client's owner is done with it
+ */
+bool Client::isReleased() const {
+    return _released;
+}
+
+/**
+ * @brief Mark the client to be freed as soon as its socket is closed
+ */
+void Client::setReleased(bool released) {
+    _released = released;
+}
+
+/**
+ * @brief Get the client's flood control budget
+ */
+TokenBucket& Client::getFloodBucket() {
+    return _flood;
+}
+
+/**
+ * @brief Check if reading from the client is paused by flood control
+ */
+bool Client::isThrottled() const {
+    return _throttled;
+}
+
+/**
+ * @brief Pause or resume reading from the client (flood control)
+ */
+void Client::setThrottled(bool throttled) {
+    _throttled = throttled;
+}
+
+/**
+ * @brief Get where the client is on its Reactor's throttled list
+ */
+unsigned int Client::getThrottleIndex() const {
+    return _throttleIndex;
+}
+
+/**
+ * @brief Remember where the client is on its Reactor's throttled list
+ */
+void Client::setThrottleIndex(unsigned int index) {
+    _throttleIndex = index;
+}
+
+/**
+ * @brief Check if the client is waiting on the ready list for its next read turn
+ */
+bool Client::isReadyQueued() const {
+    return _readyQueued;
+}
+
+/**
+ * @brief Remember whether the client is on the ready list
+ */
+void Client::setReadyQueued(bool queued) {
+    _readyQueued = queued;
+}
+
+/**
+ * @brief Get where the client is on its Reactor's ready list
+ */
+unsigned int Client::getReadyIndex() const {
+    return _readyIndex;
+}
+
+/**
+ * @brief Remember where the client is on its Reactor's ready list
+ */
+void Client::setReadyIndex(unsigned int index) {
+    _readyIndex = index;
+}
+
+/**
+ * @brief Get the timer of the client's registration deadline and keepalive
+ */
+Timer& Client::getTimer() {
+    return _timer;
+}
+
+/**
+ * @brief Get what the client's timer is waiting for
+ */
+Liveness Client::getLiveness() const {
+    return static_cast<Liveness>(_liveness);
+}
+
+/**
+ * @brief Set what the client's timer is waiting for
+ */
+void Client::setLiveness(Liveness liveness) {
+    _liveness = liveness;
+}
+
+/**
+ * @brief Get when input was last read from the client, in milliseconds
+ */
+unsigned long Client::getLastInput() const {
+    return _lastInput;
+}
+
+/**
+ * @brief Remember that input was just read from the client
+ */
+void Client::setLastInput(unsigned long now) {
+    _lastInput = now;
+}
+
+/**
+ * @brief Check if the listener was already told about pending output
+ */
+bool Client::isFlushScheduled() const {
+    return _flushScheduled;
+}
+
+/**
+ * @brief Mark whether a flush is scheduled
+ */
+void Client::setFlushScheduled(bool scheduled) {
+    _flushScheduled = scheduled;
+}
+
+/**
+ * @brief Check if we asked to be woken up when the socket is writable
+ */
+bool Client::isWriteArmed() const {
+    return _writeArmed;
+}
+
+/**
+ * @brief Remember whether write notifications are enabled
+ */
+void Client::setWriteArmed(bool armed) {
+    _writeArmed = armed;
+}
+
+/**
+ * @brief Remember that the client joined a channel
+ * @param channel The channel joined
+ *
+ * Keeping the list on the client lets QUIT and NICK reach every channel the
+ * client is in without looking at all channels of the server.
+ */
+void Client::addChannel(const ChannelHandle& channel) {
+    if (std::find(_channels.begin(), _channels.end(), channel) == _channels.end()) {
+        _channels.push_back(channel);
+    }
+}
+
+/**
+ * @brief Forget a channel the client left
+ * @param channel The channel left
+ */
+void Client::removeChannel(const ChannelHandle& channel) {
+    std::vector<ChannelHandle>::iterator it = std::find(_channels.begin(), _channels.end(), channel);
+    if (it != _channels.end()) {
+        _channels.erase(it);
+    }
+}
+
+/**
+ * @brief Get the channels the client has joined
+ *
+ * Resolve them with Channel::pool().get(); a handle of a channel that was
+ * destroyed resolves to NULL.
+ */
+const std::vector<ChannelHandle>& Client::getChannels() const {
+    return _channels;
+}
+
+/**
+ * @brief Ask the server to drop this client once the current command is done
+ * @param reason Quit message shown to the other users
+ */
+void Client::markDisconnect(const std::string& reason) {
+    if (!_disconnecting) {
+        _disconnecting = true;
+        _identity.set(Identity::QUIT_REASON, reason.data(), reason.length());
+    }
+}
+
+/**
+ * @brief Check if the client is about to be dropped
+ */
+bool Client::isDisconnecting() const {
+    return _disconnecting;
 }
 
 /**
- * @brief Clear the client's input buffer
+ * @brief Get the reason given when the client was marked for disconnection
  */
-void Client::clearBuffer() {
-    _buffer.clear();  // clear() is a std::string method that empties the string
+StringRef Client::getQuitReason() const {
+    return _identity.get(Identity::QUIT_REASON);
 }
 
 /**
  * @brief Get the IRC prefix for this client
- * @return The prefix string in format "nickname!username@hostname"
+ * @return The prefix in format "nickname!username@hostname"
  * 
  * IRC messages from clients are prefixed with their identity.
- * This is used when forwarding messages to other clients.
+ * This is used when forwarding messages to other clients. Both parts are
+ * views of what the client already holds, "nickname!username@" in the
+ * Identity arena (laid out again only by NICK and USER) and the hostname
+ * atom, so nothing is built or allocated here.
  */
-std::string Client::getPrefix() const {
-    return _nickname + "!" + _username + "@" + _hostname;
+Prefix Client::getPrefix() const {
+    Prefix prefix;
+    prefix.head = _identity.prefix();
+    prefix.host = _hostname.ref();
+    return prefix;
 }
@@ -2,39 +2,136 @@
 #define CLIENT_HPP
 
 #include "ircserv.hpp"
+#include "SendQueue.hpp"
+#include "LineBuffer.hpp"
+#include "Mailbox.hpp"
+#include "TokenBucket.hpp"
+#include "TimerWheel.hpp"
+#include "Identity.hpp"
+#include "Atom.hpp"
+
+/**
+ * @brief Interface used by a Client to tell the event loop it has output
+ *
+ * The server implements this so it learns which clients need a flush without
+ * scanning all of them.
+ */
+class OutputListener {
+public:
+    virtual ~OutputListener() {}
+    virtual void onOutputQueued(Client* client) = 0;
+};
+
+// Where a connection is in its keepalive cycle (driven by its Reactor)
+enum Liveness {
+    LIVE_REGISTERING,           // Must register before its deadline
+    LIVE_IDLE,                  // Pinged once it has been silent for the ping interval
+    LIVE_PINGED                 // Dropped unless it sends something before the ping timeout
+};
+
+/**
+ * @brief A client's message prefix, "nickname!username@hostname", as two views
+ *
+ * The Identity arena keeps "nickname!username@" and the hostname is a shared
+ * Atom, so neither is rebuilt per message: concatenating a Prefix copies both
+ * straight into the message being built, without a temporary string.
+ */
+struct Prefix {
+    StringRef head;             // "nickname!username@", from the Identity arena
+    StringRef host;             // Hostname, from the atom
+
+    size_t length() const { return head.length + host.length; }
+};
+
+// Concatenation, so a Prefix is used where messages are built from strings
+inline std::string operator+(const char* left, const Prefix& right) {
+    std::string result(left);
+    result.reserve(result.size() + right.length());
+    result.append(right.head.data, right.head.length);
+    return result.append(right.host.data, right.host.length);
+}
+
+inline std::string operator+(const std::string& left, const Prefix& right) {
+    std::string result;
+    result.reserve(left.size() + right.length());
+    result.append(left).append(right.head.data, right.head.length);
+    return result.append(right.host.data, right.host.length);
+}
+
+// Default sendq limit: a client this far behind is disconnected
+const size_t DEFAULT_SENDQ_LIMIT = 256 * 1024;
 
 /**
  * @brief The Client class represents a connected IRC client
  * 
  * This class stores all information about a client connected to our IRC server.
  * Each client has a socket file descriptor, nickname, username, and various states.
+ *
+ * Most connections are idle most of the time, so the record is kept small.
+ * What the event loop touches on every read and flush comes first; the IRC
+ * state the command handlers use comes last, and its strings live in one
+ * Identity arena, except the hostname, which is an Atom shared by every
+ * client from the same host. Flags are bit-fields, in two groups that
+ * different threads write in multi-threaded mode (the Reactor owning the
+ * socket, the hub running the commands), so they never share a memory
+ * location. Input and output buffers only hold memory while there is data in
+ * them.
  */
 class Client {
 private:
+    // Socket state, used by the Reactor owning the socket
     int _fd;                    // File descriptor for the client's socket connection
-    std::string _nickname;      // Client's nickname (what others see)
-    std::string _username;      // Client's username (for identification)
-    std::string _realname;      // Client's real name
-    std::string _hostname;      // Client's hostname/IP address
-    std::string _buffer;        // Buffer to store incoming data
-    bool _authenticated;        // Whether client has provided correct password
-    bool _registered;           // Whether client has completed registration (NICK + USER)
-    bool _welcomeSent;          // Whether we've sent the welcome message
+    bool _sendqExceeded : 1;    // Set when the client fell too far behind
+    bool _flushScheduled : 1;   // Whether the listener already knows about pending output
+    bool _writeArmed : 1;       // Whether we are waiting for the socket to become writable
+    bool _attached : 1;         // Whether a Reactor is watching the socket
+    bool _released : 1;         // Whether the owner is done with it (free once the socket is closed)
+    bool _throttled : 1;        // Whether reading is paused until the budget refills
+    bool _readyQueued : 1;      // Whether its read budget ran out with input left (on the Reactor's ready list)
+    unsigned int _liveness : 2; // What _timer is waiting for (a Liveness)
+    unsigned int _throttleIndex;    // Position in the Reactor's throttled list, while _throttled
+    unsigned int _readyIndex;       // Position in the Reactor's ready list, while _readyQueued
+    LineBuffer _input;          // Incoming data, framed into lines in place
+    SendQueue _sendq;           // Data waiting to be written to the socket
+    size_t _sendqLimit;         // Maximum bytes allowed in _sendq
+    OutputListener* _listener;  // Notified when output is queued (the client's Reactor)
+    Mailbox* _outbox;           // Multi-threaded mode: inbox of the IO thread owning the socket
+    Payload* _staged;           // Multi-threaded mode: output being written via prepareOutput()
+    unsigned long _lastInput;   // When the socket was last read from, in milliseconds
+    TokenBucket _flood;         // Flood control budget (used by the Reactor only)
+    Timer _timer;               // Registration deadline or keepalive (used by the Reactor only)
 
-public:
-    // Constructor
+    // IRC state, used by the command handlers
+    std::vector<ChannelHandle> _channels;   // Channels the client has joined
+    Identity _identity;         // Nickname, username, real name and quit reason
+    Atom _hostname;             // Shared per host and never changed, so the Reactor reads it too
+    bool _authenticated : 1;    // Whether client has provided correct password
+    bool _registered : 1;       // Whether client has completed registration (NICK + USER)
+    bool _welcomeSent : 1;      // Whether we've sent the welcome message
+    bool _disconnecting : 1;    // Set by QUIT (or an error) once the client must be dropped
+
+    // Copying would duplicate the socket ownership
+    Client(const Client& other);
+    Client& operator=(const Client& other);
+
+    // Only the pool constructs and destroys clients
+    friend class SlabPool<Client>;
     Client(int fd, const std::string& hostname);
-    
-    // Destructor
     ~Client();
+
+    bool reserveOutput(size_t length);
+
+public:
+    // Clients live in a slab pool: create them with pool().create(fd, hostname)
+    static SlabPool<Client>& pool();
+    ClientHandle getHandle() const;
     
     // Getters (const means they don't modify the object)
     int getFd() const;
-    const std::string& getNickname() const;
-    const std::string& getUsername() const;
-    const std::string& getRealname() const;
-    const std::string& getHostname() const;
-    const std::string& getBuffer() const;
+    StringRef getNickname() const;
+    StringRef getUsername() const;
+    StringRef getRealname() const;
+    StringRef getHostname() const;
     bool isAuthenticated() const;
     bool isRegistered() const;
     bool isWelcomeSent() const;
@@ -47,12 +144,67 @@ public:
     void setRegistered(bool reg);
     void setWelcomeSent(bool sent);
     
-    // Buffer operations
-    void appendToBuffer(const std::string& data);
-    void clearBuffer();
+    // Input operations
+    ssize_t readInput();
+    size_t appendInput(const char* data, size_t length);
+    LineBuffer::Status nextLine(StringRef& line);
+    void unreadLine();
+    size_t getInputSize() const;
+    void setInputPool(RecvPool* pool);
+    void releaseInput();
+    
+    // Output queue
+    bool queueOutput(const std::string& data);
+    bool queueOutput(const char* data, size_t length);
+    bool queueOutput(Payload* payload);
+    bool deliverOutput(Payload* payload);
+    char* prepareOutput(size_t length);
+    void commitOutput();
+    SendQueue::FlushResult flushOutput(unsigned long* writes = NULL);
+    int gatherOutput(struct iovec* iov, Payload** chunks, int max, size_t* bytes = NULL) const;
+    void consumeOutput(size_t length);
+    bool hasPendingOutput() const;
+    size_t getSendqSize() const;
+    bool isSendqExceeded() const;
+    void setSendqLimit(size_t limit);
+    void setOutputListener(OutputListener* listener);
+    void setOutbox(Mailbox* outbox);
+    Mailbox* getOutbox() const;
+    bool isAttached() const;
+    void setAttached(bool attached);
+    bool isReleased() const;
+    void setReleased(bool released);
+    TokenBucket& getFloodBucket();
+    bool isThrottled() const;
+    void setThrottled(bool throttled);
+    unsigned int getThrottleIndex() const;
+    void setThrottleIndex(unsigned int index);
+    bool isReadyQueued() const;
+    void setReadyQueued(bool queued);
+    unsigned int getReadyIndex() const;
+    void setReadyIndex(unsigned int index);
+    Timer& getTimer();
+    Liveness getLiveness() const;
+    void setLiveness(Liveness liveness);
+    unsigned long getLastInput() const;
+    void setLastInput(unsigned long now);
+    bool isFlushScheduled() const;
+    void setFlushScheduled(bool scheduled);
+    bool isWriteArmed() const;
+    void setWriteArmed(bool armed);
+    
+    // Joined channels
+    void addChannel(const ChannelHandle& channel);
+    void removeChannel(const ChannelHandle& channel);
+    const std::vector<ChannelHandle>& getChannels() const;
+    
+    // Disconnection
+    void markDisconnect(const std::string& reason);
+    bool isDisconnecting() const;
+    StringRef getQuitReason() const;
     
     // Helper functions
-    std::string getPrefix() const;  // Returns the IRC prefix (nickname!username@hostname)
+    Prefix getPrefix() const;       // Returns the IRC prefix (nickname!username@hostname)
 };
 
 #endif
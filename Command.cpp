@@ -0,0 +1,122 @@
+#include "Command.hpp"
+
+// Canonical names, indexed by CommandId
+static const char* const NAMES[CMD_COUNT + 1] = {
+    "PASS", "NICK", "USER", "JOIN", "PART", "PRIVMSG", "NOTICE",
+    "KICK", "INVITE", "TOPIC", "NAMES", "MODE", "QUIT", "PING", "PONG", "UNKNOWN"
+};
+
+// Flood control cost, indexed by CommandId: commands that make the server
+// send more (JOIN and NAMES reply with the member list, NICK goes to every
+// shared channel) cost more. QUIT is free so a throttled client can always
+// leave.
+static const unsigned int COSTS[CMD_COUNT + 1] = {
+    1, 3, 1, 5, 2, 2, 2,
+    3, 3, 2, 4, 2, 0, 1, 1, 2
+};
+
+/**
+ * @brief Fold an ASCII letter to uppercase
+ */
+static char upper(char c) {
+    return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+/**
+ * @brief Compare a name with an uppercase command of the same length
+ * @param name The name from the message (any case)
+ * @param expected Uppercase command name, exactly name.length characters
+ * @param id Returned if the names match
+ * @return id on match, CMD_UNKNOWN otherwise
+ */
+static CommandId match(const StringRef& name, const char* expected, CommandId id) {
+    for (size_t i = 1; i < name.length; ++i) {  // The first letter was switched on already
+        if (upper(name[i]) != expected[i])
+            return CMD_UNKNOWN;
+    }
+    return id;
+}
+
+/**
+ * @brief Recognize a command name
+ * @param name The command token of a parsed message
+ * @return The command identifier, or CMD_UNKNOWN
+ */
+CommandId Command::lookup(const StringRef& name) {
+    if (name.length < 4 || name.length > 7)
+        return CMD_UNKNOWN;
+
+    char first = upper(name[0]);
+    switch (name.length) {
+    case 4:
+        switch (first) {
+        case 'P':
+            if (upper(name[1]) == 'I') return match(name, "PING", CMD_PING);
+            if (upper(name[1]) == 'O') return match(name, "PONG", CMD_PONG);
+            if (upper(name[2]) == 'S') return match(name, "PASS", CMD_PASS);
+            return match(name, "PART", CMD_PART);
+        case 'N': return match(name, "NICK", CMD_NICK);
+        case 'U': return match(name, "USER", CMD_USER);
+        case 'J': return match(name, "JOIN", CMD_JOIN);
+        case 'K': return match(name, "KICK", CMD_KICK);
+        case 'M': return match(name, "MODE", CMD_MODE);
+        case 'Q': return match(name, "QUIT", CMD_QUIT);
+        }
+        break;
+    case 5:
+        if (first == 'T') return match(name, "TOPIC", CMD_TOPIC);
+        if (first == 'N') return match(name, "NAMES", CMD_NAMES);
+        break;
+    case 6:
+        if (first == 'N') return match(name, "NOTICE", CMD_NOTICE);
+        if (first == 'I') return match(name, "INVITE", CMD_INVITE);
+        break;
+    case 7:
+        if (first == 'P') return match(name, "PRIVMSG", CMD_PRIVMSG);
+        break;
+    }
+    return CMD_UNKNOWN;
+}
+
+/**
+ * @brief Recognize the command of a raw line, without parsing the rest
+ * @param line A complete line, as framed by LineBuffer
+ *
+ * Skips the optional ":prefix" and takes the next word; used by the event
+ * loop to charge flood control before the line is handed on.
+ */
+CommandId Command::lookupLine(const StringRef& line) {
+    size_t i = 0;
+    if (i < line.length && line[i] == ':') {
+        while (i < line.length && line[i] != ' ')
+            ++i;
+    }
+    while (i < line.length && line[i] == ' ')
+        ++i;
+    size_t start = i;
+    while (i < line.length && line[i] != ' ')
+        ++i;
+    return lookup(StringRef(line.data + start, i - start));
+}
+
+/**
+ * @brief Get the canonical (uppercase) name of a command
+ */
+const char* Command::name(CommandId id) {
+    return NAMES[id];
+}
+
+/**
+ * @brief Check if a command may be used before NICK/USER registration is done
+ */
+bool Command::allowedBeforeRegistration(CommandId id) {
+    return id == CMD_PASS || id == CMD_NICK || id == CMD_USER || id == CMD_QUIT || id == CMD_PING ||
+           id == CMD_PONG;
+}
+
+/**
+ * @brief Get the flood control cost of a command (see TokenBucket)
+ */
+unsigned int Command::cost(CommandId id) {
+    return COSTS[id];
+}
@@ -0,0 +1,51 @@
+#ifndef COMMAND_HPP
+#define COMMAND_HPP
+
+#include "StringRef.hpp"
+
+/**
+ * @brief Identifier of each command the server understands
+ *
+ * The server keeps one handler and one counter per identifier, so dispatching
+ * a command is an array index once lookup() has recognized the name.
+ */
+enum CommandId {
+    CMD_PASS,
+    CMD_NICK,
+    CMD_USER,
+    CMD_JOIN,
+    CMD_PART,
+    CMD_PRIVMSG,
+    CMD_NOTICE,
+    CMD_KICK,
+    CMD_INVITE,
+    CMD_TOPIC,
+    CMD_NAMES,
+    CMD_MODE,
+    CMD_QUIT,
+    CMD_PING,
+    CMD_PONG,
+    CMD_COUNT,                  // Number of known commands
+    CMD_UNKNOWN = CMD_COUNT     // Anything else
+};
+
+/**
+ * @brief Command name lookup
+ *
+ * lookup() switches on the name length and first letter, which leaves at most
+ * three candidates, then compares case-insensitively in place: no string is
+ * built and no map is searched.
+ */
+class Command {
+public:
+    // Highest cost() of any command; a flood control burst must cover it
+    static const unsigned int MAX_COST = 5;
+
+    static CommandId lookup(const StringRef& name);
+    static CommandId lookupLine(const StringRef& line);
+    static const char* name(CommandId id);
+    static bool allowedBeforeRegistration(CommandId id);
+    static unsigned int cost(CommandId id);
+};
+
+#endif
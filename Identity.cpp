@@ -0,0 +1,88 @@
+#include "Identity.hpp"
+#include <cstring>
+
+// Longest string kept (a length is stored in an unsigned short); IRC lines
+// are far shorter
+static const size_t MAX_FIELD = 65535;
+
+// Bytes before the strings
+static const size_t HEADER = Identity::FIELD_COUNT * sizeof(unsigned short);
+
+/**
+ * @brief Constructor for Identity, every string starts empty
+ */
+Identity::Identity() : _arena(NULL) {
+}
+
+/**
+ * @brief Destructor for Identity
+ */
+Identity::~Identity() {
+    delete[] _arena;
+}
+
+const unsigned short* Identity::lengths() const {
+    return reinterpret_cast<const unsigned short*>(_arena);
+}
+
+const char* Identity::strings() const {
+    return _arena + HEADER;
+}
+
+/**
+ * @brief Get one of the strings (empty if never set)
+ */
+StringRef Identity::get(Field field) const {
+    if (!_arena)
+        return StringRef();
+    const unsigned short* length = lengths();
+    // The nickname and username are followed by '!' and '@'
+    size_t offset = 0;
+    for (int i = 0; i < field; ++i)
+        offset += length[i] + (i <= USERNAME ? 1 : 0);
+    return StringRef(strings() + offset, length[field]);
+}
+
+/**
+ * @brief Replace one of the strings, laying the arena out again
+ * @param field The string to replace
+ * @param value Its new value (may point into the arena)
+ * @param length Its length
+ */
+void Identity::set(Field field, const char* value, size_t length) {
+    if (length > MAX_FIELD)
+        length = MAX_FIELD;
+
+    unsigned short sizes[FIELD_COUNT];
+    size_t total = HEADER + 2;      // '!' and '@'
+    for (int i = 0; i < FIELD_COUNT; ++i) {
+        sizes[i] = (i == field) ? length : (_arena ? lengths()[i] : 0);
+        total += sizes[i];
+    }
+
+    char* arena = new char[total];
+    std::memcpy(arena, sizes, HEADER);
+    char* out = arena + HEADER;
+    for (int i = 0; i < FIELD_COUNT; ++i) {
+        StringRef part = (i == field) ? StringRef(value, length) : get(static_cast<Field>(i));
+        if (part.length > 0)
+            std::memcpy(out, part.data, part.length);
+        out += part.length;
+        if (i == NICKNAME)
+            *out++ = '!';
+        else if (i == USERNAME)
+            *out++ = '@';
+    }
+    delete[] _arena;
+    _arena = arena;
+}
+
+/**
+ * @brief Get "nickname!username@", the prefix of the client's messages up to the hostname
+ */
+StringRef Identity::prefix() const {
+    if (!_arena)
+        return StringRef("!@", 2);
+    const unsigned short* length = lengths();
+    return StringRef(strings(), length[NICKNAME] + length[USERNAME] + 2);
+}
@@ -0,0 +1,48 @@
+#ifndef IDENTITY_HPP
+#define IDENTITY_HPP
+
+#include <cstddef>
+#include "StringRef.hpp"
+
+/**
+ * @brief The strings describing a client, packed into one small allocation
+ *
+ * Nickname and username are stored back to back as "nick!user@", the start
+ * of the prefix of every message the client sends, so prefix() is a view of
+ * the arena and only the hostname (kept by the Client as a shared Atom) is
+ * appended to it. The real name and the quit reason follow. Their lengths
+ * head the arena, so the owner holds a single pointer for all of them.
+ *
+ * Setting a string lays the arena out again. That happens a few times per
+ * connection (USER, each NICK, QUIT); the prefix is read for every message.
+ * Views returned by get() and prefix() are valid until the next set().
+ */
+class Identity {
+public:
+    enum Field {
+        NICKNAME,
+        USERNAME,
+        REALNAME,
+        QUIT_REASON,
+        FIELD_COUNT
+    };
+
+private:
+    char* _arena;       // FIELD_COUNT lengths, then the strings; NULL while all are empty
+
+    Identity(const Identity&);
+    Identity& operator=(const Identity&);
+
+    const unsigned short* lengths() const;
+    const char* strings() const;
+
+public:
+    Identity();
+    ~Identity();
+
+    StringRef get(Field field) const;
+    void set(Field field, const char* value, size_t length);
+    StringRef prefix() const;
+};
+
+#endif
@@ -0,0 +1,388 @@
+#include "IoUring.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#ifdef __linux__
+# include <linux/io_uring.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/utsname.h>
+# include <poll.h>
+# include <unistd.h>
+#endif
+
+/**
+ * @brief Check if more completions follow for the same operation
+ */
+bool IoUring::Completion::hasMore() const {
+#ifdef __linux__
+    return (flags & IORING_CQE_F_MORE) != 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Check if the data is in a provided buffer (see buffer())
+ */
+bool IoUring::Completion::hasBuffer() const {
+#ifdef __linux__
+    return (flags & IORING_CQE_F_BUFFER) != 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Get the id of the provided buffer holding the data
+ */
+unsigned int IoUring::Completion::buffer() const {
+#ifdef __linux__
+    return flags >> IORING_CQE_BUFFER_SHIFT;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Constructor for IoUring, nothing is set up before open()
+ */
+IoUring::IoUring()
+    : _fd(-1), _sqEntries(0), _sqHead(NULL), _sqTail(NULL), _sqMask(0), _sqLocalTail(0), _sqes(NULL),
+      _cqHead(NULL), _cqTail(NULL), _cqMask(0), _cqes(NULL), _sqesSize(0), _bufRing(NULL), _bufRingSize(0),
+      _buffers(NULL), _bufCount(0), _bufSize(0), _bufTail(0), _bufFree(0), _enters(0) {
+    _rings[0] = _rings[1] = NULL;
+    _ringSizes[0] = _ringSizes[1] = 0;
+}
+
+/**
+ * @brief Destructor for IoUring, closing the ring cancels what is in flight
+ */
+IoUring::~IoUring() {
+#ifdef __linux__
+    if (_fd != -1)
+        close(_fd);
+    for (int i = 0; i < 2; ++i) {
+        if (_rings[i])
+            munmap(_rings[i], _ringSizes[i]);
+    }
+    if (_sqes)
+        munmap(_sqes, _sqesSize);
+    if (_bufRing)
+        munmap(_bufRing, _bufRingSize);
+#endif
+    delete[] _buffers;
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Check if the kernel supports everything the server uses
+ *
+ * Multishot recv has no feature bit, so the kernel version is checked for it
+ * (6.0); the rest is probed on a small ring.
+ */
+bool IoUring::isSupported() {
+    struct utsname system;
+    if (uname(&system) == -1 || std::atoi(system.release) < 6)
+        return false;
+
+    IoUring ring;
+    if (!ring.open(4))
+        return false;
+
+    static const int NEEDED[] = { IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_POLL_ADD,
+                                  IORING_OP_ASYNC_CANCEL };
+    size_t size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = static_cast<struct io_uring_probe*>(std::calloc(1, size));
+    if (!probe)
+        return false;
+    bool supported = syscall(__NR_io_uring_register, ring._fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0;
+    for (size_t i = 0; supported && i < sizeof(NEEDED) / sizeof(NEEDED[0]); ++i) {
+        supported = NEEDED[i] <= probe->last_op && (probe->ops[NEEDED[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    std::free(probe);
+    return supported && ring.provideBuffers(2, 64);
+}
+
+/**
+ * @brief Create the ring and map it
+ * @param entries Submission ring size (power of two); the completion ring
+ *                gets 8 times more, for multishot operations
+ * @return false if io_uring is unavailable or lacks a feature we rely on
+ */
+bool IoUring::open(unsigned int entries) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = entries * 8;
+    _fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (_fd == -1 && errno == EINVAL) {
+        // Before 5.19: no cooperative task running, fine for one thread per ring
+        params.flags &= ~IORING_SETUP_COOP_TASKRUN;
+        _fd = syscall(__NR_io_uring_setup, entries, &params);
+    }
+    if (_fd == -1)
+        return false;
+
+    // No completion is ever dropped, waits take a timeout, and sendmsg()
+    // headers may go once submitted
+    unsigned int needed = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_SUBMIT_STABLE |
+                          IORING_FEAT_FAST_POLL;
+    if ((params.features & needed) != needed)
+        return false;
+
+    _ringSizes[0] = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    _ringSizes[1] = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sq = mmap(NULL, _ringSizes[0], PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    void* cq = mmap(NULL, _ringSizes[1], PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+    void* sqes = mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+    _rings[0] = sq == MAP_FAILED ? NULL : sq;
+    _rings[1] = cq == MAP_FAILED ? NULL : cq;
+    _sqes = sqes == MAP_FAILED ? NULL : sqes;
+    if (!_rings[0] || !_rings[1] || !_sqes)
+        return false;
+
+    char* sqBase = static_cast<char*>(sq);
+    char* cqBase = static_cast<char*>(cq);
+    _sqEntries = params.sq_entries;
+    _sqHead = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.head);
+    _sqTail = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.tail);
+    _sqMask = *reinterpret_cast<unsigned int*>(sqBase + params.sq_off.ring_mask);
+    _sqLocalTail = *_sqTail;
+    _cqHead = reinterpret_cast<unsigned int*>(cqBase + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned int*>(cqBase + params.cq_off.tail);
+    _cqMask = *reinterpret_cast<unsigned int*>(cqBase + params.cq_off.ring_mask);
+    _cqes = cqBase + params.cq_off.cqes;
+
+    // Entries are used in ring order, so the indirection array is the identity
+    unsigned int* array = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.array);
+    for (unsigned int i = 0; i < _sqEntries; ++i)
+        array[i] = i;
+    return true;
+}
+
+/**
+ * @brief Register a ring of receive buffers for multishot recv (group 0)
+ * @param count Number of buffers (power of two, at most 32768)
+ * @param size Bytes per buffer
+ */
+bool IoUring::provideBuffers(unsigned int count, unsigned int size) {
+    _bufRingSize = count * sizeof(struct io_uring_buf);
+    void* ring = mmap(NULL, _bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+        return false;
+    _bufRing = ring;
+
+    struct io_uring_buf_reg registration;
+    std::memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<unsigned long>(ring);
+    registration.ring_entries = count;
+    registration.bgid = 0;
+    if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0)
+        return false;
+
+    _buffers = new char[static_cast<size_t>(count) * size];
+    _bufCount = count;
+    _bufSize = size;
+    for (unsigned int id = 0; id < count; ++id)
+        recycle(id);
+    return true;
+}
+
+/**
+ * @brief Get a cleared submission entry, making room by submitting if the ring is full
+ */
+void* IoUring::next() {
+    if (_sqLocalTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) == _sqEntries)
+        enter(_sqEntries, 0, 0);
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(_sqes) + (_sqLocalTail & _sqMask);
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++_sqLocalTail;
+    return sqe;
+}
+
+/**
+ * @brief Accept connections until cancelled; each completion is a new
+ *        (non-blocking) socket
+ */
+void IoUring::acceptMultishot(int fd, unsigned long long tag) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(next());
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = tag;
+}
+
+/**
+ * @brief Receive until cancelled, end of stream or error, into provided buffers
+ */
+void IoUring::recvMultishot(int fd, unsigned long long tag) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(next());
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = tag;
+}
+
+/**
+ * @brief Report every time the descriptor becomes readable, until cancelled
+ */
+void IoUring::pollMultishot(int fd, unsigned long long tag) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(next());
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = tag;
+}
+
+/**
+ * @brief Send a message; the header and iovecs may be reused once submitted,
+ *        the data must stay until the completion
+ */
+void IoUring::sendmsg(int fd, const struct msghdr* message, unsigned long long tag) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(next());
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<unsigned long>(message);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = tag;
+}
+
+/**
+ * @brief Cancel the operation with the given tag
+ */
+void IoUring::cancel(unsigned long long target, unsigned long long tag) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(next());
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = tag;
+}
+
+/**
+ * @brief Hand entries to the kernel and optionally wait for a completion
+ * @param wait Minimum number of completions to wait for (0 or 1)
+ * @param timeoutMs Longest wait (-1 = forever)
+ * @return 0 on success (including a timeout or a signal), -1 on error
+ */
+int IoUring::enter(unsigned int submit, unsigned int wait, int timeoutMs) {
+    struct __kernel_timespec timeout;
+    struct io_uring_getevents_arg arg;
+    std::memset(&arg, 0, sizeof(arg));
+    if (wait > 0 && timeoutMs >= 0) {
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<unsigned long>(&timeout);
+    }
+    __atomic_store_n(_sqTail, _sqLocalTail, __ATOMIC_RELEASE);
+    ++_enters;
+    long result = syscall(__NR_io_uring_enter, _fd, submit, wait, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                          &arg, sizeof(arg));
+    if (result >= 0 || errno == EINTR || errno == ETIME || errno == EBUSY || errno == EAGAIN)
+        return 0;
+    return -1;
+}
+
+/**
+ * @brief Submit everything prepared and wait for at least one completion
+ * @param timeoutMs Longest wait (-1 = forever, 0 = don't wait)
+ * @return false on error
+ */
+bool IoUring::submit(int timeoutMs) {
+    unsigned int pending = _sqLocalTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+    return enter(pending, timeoutMs == 0 ? 0 : 1, timeoutMs) == 0;
+}
+
+/**
+ * @brief Take the next completion
+ * @return false if none is ready
+ */
+bool IoUring::nextCompletion(Completion& completion) {
+    unsigned int head = *_cqHead;
+    if (head == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE))
+        return false;
+    const struct io_uring_cqe* cqe = static_cast<const struct io_uring_cqe*>(_cqes) + (head & _cqMask);
+    completion.tag = cqe->user_data;
+    completion.result = cqe->res;
+    completion.flags = cqe->flags;
+    __atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+    if (completion.hasBuffer())
+        --_bufFree;
+    return true;
+}
+
+/**
+ * @brief Give a provided buffer back to the kernel
+ */
+void IoUring::recycle(unsigned int id) {
+    // Not ring->bufs: in C++ the empty struct in front of that flexible array
+    // takes a byte and shifts it, the entries start at the ring itself
+    struct io_uring_buf_ring* ring = static_cast<struct io_uring_buf_ring*>(_bufRing);
+    struct io_uring_buf* buffer = static_cast<struct io_uring_buf*>(_bufRing) + (_bufTail & (_bufCount - 1));
+    buffer->addr = reinterpret_cast<unsigned long>(_buffers + static_cast<size_t>(id) * _bufSize);
+    buffer->len = _bufSize;
+    buffer->bid = id;
+    ++_bufTail;
+    __atomic_store_n(&ring->tail, _bufTail, __ATOMIC_RELEASE);
+    ++_bufFree;
+}
+
+#else
+
+bool IoUring::isSupported() {
+    return false;
+}
+
+bool IoUring::open(unsigned int) {
+    return false;
+}
+
+bool IoUring::provideBuffers(unsigned int, unsigned int) {
+    return false;
+}
+
+void IoUring::acceptMultishot(int, unsigned long long) {}
+void IoUring::recvMultishot(int, unsigned long long) {}
+void IoUring::pollMultishot(int, unsigned long long) {}
+void IoUring::sendmsg(int, const struct msghdr*, unsigned long long) {}
+void IoUring::cancel(unsigned long long, unsigned long long) {}
+
+bool IoUring::submit(int) {
+    return false;
+}
+
+bool IoUring::nextCompletion(Completion&) {
+    return false;
+}
+
+void IoUring::recycle(unsigned int) {}
+
+#endif
+
+/**
+ * @brief Get the data of a provided buffer named by a completion
+ */
+const char* IoUring::bufferData(unsigned int id) const {
+    return _buffers + static_cast<size_t>(id) * _bufSize;
+}
+
+/**
+ * @brief Get the number of provided buffers the kernel can still fill
+ */
+unsigned int IoUring::freeBuffers() const {
+    return _bufFree;
+}
+
+/**
+ * @brief Get the number of io_uring_enter() calls made so far
+ */
+unsigned long IoUring::enterCount() const {
+    return _enters;
+}
@@ -0,0 +1,92 @@
+#ifndef IOURING_HPP
+#define IOURING_HPP
+
+#include <cstddef>
+#include <sys/socket.h>
+
+/**
+ * @brief Minimal io_uring instance for socket I/O (raw system calls, Linux only)
+ *
+ * Operations are queued in the submission ring and handed to the kernel in
+ * one io_uring_enter() call, which also waits for completions, so a whole
+ * event loop iteration of accepts, reads and writes costs one system call.
+ * Each operation carries a 64-bit tag that comes back with its completions.
+ *
+ * Multishot operations (accept, recv, poll) keep producing completions until
+ * they are cancelled or fail; a completion without hasMore() is their last.
+ * Multishot recv takes its memory from a ring of provided buffers (see
+ * provideBuffers()): a completion names the buffer holding the data, which
+ * belongs to the caller until it is given back with recycle().
+ *
+ * On other systems, or kernels without what this needs (6.0: multishot
+ * recv), isSupported() is false and open() fails.
+ */
+class IoUring {
+public:
+    struct Completion {
+        unsigned long long tag;     // Tag of the operation
+        int result;                 // Its return value, or -errno
+        unsigned int flags;         // IORING_CQE_F_* bits
+
+        bool hasMore() const;       // More completions will follow for this operation
+        bool hasBuffer() const;     // Data was placed in a provided buffer
+        unsigned int buffer() const;
+    };
+
+private:
+    int _fd;
+    unsigned int _sqEntries;
+    unsigned int* _sqHead;
+    unsigned int* _sqTail;
+    unsigned int _sqMask;
+    unsigned int _sqLocalTail;      // Entries prepared, published on submit
+    void* _sqes;
+    unsigned int* _cqHead;
+    unsigned int* _cqTail;
+    unsigned int _cqMask;
+    void* _cqes;
+    void* _rings[2];                // SQ and CQ ring mappings
+    size_t _ringSizes[2];
+    size_t _sqesSize;
+
+    void* _bufRing;                 // Provided buffer ring (shared with the kernel)
+    size_t _bufRingSize;
+    char* _buffers;
+    unsigned int _bufCount;
+    unsigned int _bufSize;
+    unsigned short _bufTail;        // Local copy of the ring tail
+    unsigned int _bufFree;          // Buffers in the ring, available to the kernel
+
+    unsigned long _enters;          // io_uring_enter() calls made
+
+    IoUring(const IoUring&);
+    IoUring& operator=(const IoUring&);
+
+    void* next();
+    int enter(unsigned int submit, unsigned int wait, int timeoutMs);
+
+public:
+    IoUring();
+    ~IoUring();
+
+    static bool isSupported();
+
+    bool open(unsigned int entries);
+    bool provideBuffers(unsigned int count, unsigned int size);
+
+    void acceptMultishot(int fd, unsigned long long tag);
+    void recvMultishot(int fd, unsigned long long tag);
+    void pollMultishot(int fd, unsigned long long tag);
+    void sendmsg(int fd, const struct msghdr* message, unsigned long long tag);
+    void cancel(unsigned long long target, unsigned long long tag);
+
+    bool submit(int timeoutMs);
+    bool nextCompletion(Completion& completion);
+
+    const char* bufferData(unsigned int id) const;
+    void recycle(unsigned int id);
+    unsigned int freeBuffers() const;
+    unsigned long enterCount() const;
+};
+
+#endif
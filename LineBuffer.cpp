@@ -0,0 +1,194 @@
+#include "LineBuffer.hpp"
+#include "RecvPool.hpp"
+#include <sys/socket.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+/**
+ * @brief Constructor for LineBuffer, memory is only allocated on first read
+ */
+LineBuffer::LineBuffer()
+    : _data(NULL), _pool(NULL), _capacity(CAPACITY), _start(0), _end(0), _scan(0), _last(0), _discarding(false) {
+}
+
+/**
+ * @brief Destructor for LineBuffer
+ */
+LineBuffer::~LineBuffer() {
+    if (_pool && _data)
+        _pool->release(_data);
+    else
+        delete[] _data;
+}
+
+/**
+ * @brief Take receive memory from a pool from now on (buffered data is dropped)
+ * @param pool Pool whose chunks hold more than MAX_LINE bytes, NULL to own a buffer
+ */
+void LineBuffer::setPool(RecvPool* pool) {
+    clear();            // Gives a chunk back
+    if (!_pool)
+        delete[] _data;
+    _data = NULL;
+    _pool = pool;
+    _capacity = pool ? pool->chunkSize() : CAPACITY;
+}
+
+/**
+ * @brief Make sure there is memory to receive into
+ */
+void LineBuffer::reserve() {
+    if (!_data)
+        _data = _pool ? _pool->acquire() : new char[_capacity];
+}
+
+/**
+ * @brief Make sure there is space after _end for the next recv()
+ *
+ * When nothing is pending the indexes are simply reset. Otherwise the
+ * unfinished line (shorter than MAX_LINE) is moved to the front once the free
+ * space at the end gets smaller than one line.
+ */
+void LineBuffer::makeRoom() {
+    if (_start == _end) {
+        _start = _end = _scan = 0;
+        return;
+    }
+    if (_start > 0 && _capacity - _end < MAX_LINE) {
+        std::memmove(_data, _data + _start, _end - _start);
+        _end -= _start;
+        _scan -= _start;
+        _start = 0;
+    }
+}
+
+/**
+ * @brief Return the pool chunk once nothing is buffered
+ */
+void LineBuffer::giveBack() {
+    if (_pool && _data && _start == _end) {
+        _pool->release(_data);
+        _data = NULL;
+        _start = _end = _scan = 0;
+    }
+}
+
+/**
+ * @brief Receive data from a socket directly into the buffer
+ * @param fd The socket to read from
+ * @return Bytes received, 0 on end of stream, -1 on error (errno is set)
+ *
+ * Call nextLine() until it returns LINE_NONE before reading again, otherwise
+ * the buffer may have no free space left (reported as ENOBUFS).
+ */
+ssize_t LineBuffer::readFrom(int fd) {
+    reserve();
+    makeRoom();
+    if (_end == _capacity) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    ssize_t received = recv(fd, _data + _end, _capacity - _end, 0);
+    if (received > 0)
+        _end += received;
+    else
+        giveBack();     // Nothing came (EAGAIN most of the time)
+    return received;
+}
+
+/**
+ * @brief Copy received data into the buffer (when the socket was read elsewhere)
+ * @param data Bytes received
+ * @param length Number of bytes
+ * @return Bytes copied: as many as fit, the caller keeps the rest
+ *
+ * Same rule as readFrom(): drain the lines first, so there is room.
+ */
+size_t LineBuffer::append(const char* data, size_t length) {
+    reserve();
+    makeRoom();
+    size_t copied = std::min(length, static_cast<size_t>(_capacity - _end));
+    std::memcpy(_data + _end, data, copied);
+    _end += copied;
+    return copied;
+}
+
+/**
+ * @brief Get the next complete line
+ * @param line Set to the line content, without "\r\n" (valid until the next
+ *             read, or the next call returning LINE_NONE)
+ * @return LINE_OK, LINE_NONE or LINE_TOO_LONG
+ *
+ * Both "\r\n" and a bare "\n" end a line. Once LINE_NONE is returned with
+ * nothing left over, a pool chunk goes back to the pool.
+ */
+LineBuffer::Status LineBuffer::nextLine(StringRef& line) {
+    while (true) {
+        const char* newline = static_cast<const char*>(
+            _scan < _end ? std::memchr(_data + _scan, '\n', _end - _scan) : NULL);
+
+        if (_discarding) {
+            // Drop everything up to the end of the overlong line
+            if (!newline) {
+                _start = _scan = _end;
+                giveBack();
+                return LINE_NONE;
+            }
+            _start = _scan = (newline - _data) + 1;
+            _discarding = false;
+            continue;
+        }
+
+        if (!newline) {
+            _scan = _end;
+            if (_end - _start >= MAX_LINE) {
+                // No terminator within the limit: drop until the next one
+                _discarding = true;
+                _start = _scan = _end;
+                return LINE_TOO_LONG;
+            }
+            giveBack();
+            return LINE_NONE;
+        }
+
+        size_t lineEnd = newline - _data;
+        size_t begin = _start;
+        _start = _scan = lineEnd + 1;
+        if (lineEnd + 1 - begin > MAX_LINE)
+            return LINE_TOO_LONG;
+
+        size_t length = lineEnd - begin;
+        if (length > 0 && _data[lineEnd - 1] == '\r')
+            --length;
+        line = StringRef(_data + begin, length);
+        _last = begin;
+        return LINE_OK;
+    }
+}
+
+/**
+ * @brief Put back the line returned by the last nextLine() call
+ *
+ * The next nextLine() returns it again. Only valid right after a LINE_OK,
+ * before any read; used to stop at a line that can't be handled yet.
+ */
+void LineBuffer::unread() {
+    _start = _scan = _last;
+}
+
+/**
+ * @brief Get the number of buffered bytes not yet returned as lines
+ */
+size_t LineBuffer::size() const {
+    return _end - _start;
+}
+
+/**
+ * @brief Drop all buffered data (and give a pool chunk back)
+ */
+void LineBuffer::clear() {
+    _start = _end = _scan = 0;
+    _discarding = false;
+    giveBack();
+}
@@ -0,0 +1,73 @@
+#ifndef LINEBUFFER_HPP
+#define LINEBUFFER_HPP
+
+#include <sys/types.h>
+#include "StringRef.hpp"
+
+class RecvPool;
+
+/**
+ * @brief Per-client input buffer that frames IRC lines without copying
+ *
+ * recv() writes straight into the buffer and nextLine() hands out views of
+ * complete lines in place. The search for the line terminator resumes where
+ * the previous one stopped (memchr, which the C library vectorizes), so every
+ * byte is scanned once no matter how many commands a client pipelines.
+ * Consumed bytes are skipped by moving an index; only the unfinished tail
+ * (at most one line) is ever moved back to the front.
+ *
+ * Lines are limited to 512 bytes including CRLF (RFC 1459). A longer line is
+ * dropped up to its terminator and reported once as LINE_TOO_LONG, so a
+ * client that never sends a newline cannot make the buffer grow.
+ *
+ * With a RecvPool the memory is a chunk of the pool, taken for a read and
+ * given back once every byte has been returned as lines, so a client holds
+ * receive memory only while it has an unfinished line. Without one, a
+ * CAPACITY buffer is allocated on the first read and kept.
+ */
+class LineBuffer {
+public:
+    static const size_t MAX_LINE = 512;     // Longest line, "\r\n" included
+    static const size_t CAPACITY = 4096;    // Size of the buffer without a pool
+
+    enum Status {
+        LINE_NONE,      // No complete line buffered
+        LINE_OK,        // line holds the next command (terminator stripped)
+        LINE_TOO_LONG   // A line over MAX_LINE was dropped
+    };
+
+private:
+    // Offsets are 32 bits: a buffer is at most a RecvPool chunk, and the
+    // buffer is part of every Client
+    char* _data;            // Allocated (or taken from _pool) on first read
+    RecvPool* _pool;        // Where _data comes from, NULL to own it
+    unsigned int _capacity; // Bytes in _data
+    unsigned int _start;    // First byte not yet consumed
+    unsigned int _end;      // One past the last byte received
+    unsigned int _scan;     // Where the next terminator search resumes
+    unsigned int _last;     // Start of the line last returned, for unread()
+    bool _discarding;       // Dropping the rest of an overlong line
+
+    LineBuffer(const LineBuffer&);
+    LineBuffer& operator=(const LineBuffer&);
+
+    void reserve();
+    void makeRoom();
+    void giveBack();
+
+public:
+    LineBuffer();
+    ~LineBuffer();
+
+    void setPool(RecvPool* pool);
+
+    ssize_t readFrom(int fd);
+    size_t append(const char* data, size_t length);
+    Status nextLine(StringRef& line);
+    void unread();
+
+    size_t size() const;
+    void clear();
+};
+
+#endif
@@ -0,0 +1,282 @@
+#include "Log.hpp"
+#include <pthread.h>
+#include <unistd.h>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+
+// Records in the ring (a power of two)
+static const unsigned long CAPACITY = 2048;
+
+// Longest message kept; longer ones are truncated
+static const size_t TEXT_SIZE = 232;
+
+// Bytes of formatted lines written in one write()
+static const size_t BATCH_SIZE = 64 * 1024;
+
+// Sleep of the drain thread when the ring is empty
+static const long IDLE_NANOSECONDS = 10 * 1000 * 1000;
+
+/**
+ * One message. Its turn tells who may use it: 2 * lap for a producer of that
+ * lap, 2 * lap + 1 for the drain thread once it is written, so a zeroed ring
+ * is an empty one.
+ */
+struct Record {
+    unsigned long turn;
+    long second;
+    unsigned char level;
+    unsigned char category;
+    unsigned short length;
+    char text[TEXT_SIZE];
+};
+
+/**
+ * Sampling and rate limit of one category
+ */
+struct CategoryState {
+    unsigned int oneIn;         // Keep one message in oneIn
+    unsigned int perSecond;     // Keep at most this many per second (0: no limit)
+    unsigned long seen;         // Messages offered, for sampling
+    long second;                // Second the rate limit is counting
+    unsigned long inSecond;     // Messages kept during that second
+    unsigned long shed;         // Messages sampled out or over the limit, not yet reported
+};
+
+static const char* const LEVEL_NAMES[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+static const char* const CATEGORY_NAMES[Log::CAT_COUNT] = { "server", "connection", "sendq", "admin" };
+
+static Record g_ring[CAPACITY];
+static unsigned long g_tail = 0;        // Next record a producer claims
+static unsigned long g_head = 0;        // Next record the drain thread reads (drain thread only)
+static unsigned long g_dropped = 0;     // Messages lost to a full ring, not yet reported
+static unsigned long g_droppedTotal = 0;
+static int g_level = Log::LEVEL_INFO;
+static int g_fd = 2;
+static CategoryState g_categories[Log::CAT_COUNT] = {
+    { 1, 1000, 0, 0, 0, 0 },
+    { 1, 1000, 0, 0, 0, 0 },
+    { 1, 100, 0, 0, 0, 0 },
+    { 1, 100, 0, 0, 0, 0 }
+};
+
+/**
+ * @brief Parse a level name ("debug", "info", "warn" or "error")
+ */
+bool Log::parseLevel(const std::string& name, Level& level) {
+    static const char* const names[] = { "debug", "info", "warn", "error" };
+    for (int i = LEVEL_DEBUG; i <= LEVEL_ERROR; ++i) {
+        if (name == names[i]) {
+            level = static_cast<Level>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Set the lowest level written
+ */
+void Log::setLevel(Level level) {
+    __atomic_store_n(&g_level, static_cast<int>(level), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Thin out a noisy category
+ * @param oneIn Keep one message in oneIn (1 keeps them all)
+ * @param perSecond Keep at most this many messages per second (0: no limit)
+ */
+void Log::setSampling(Category category, unsigned int oneIn, unsigned int perSecond) {
+    CategoryState& state = g_categories[category];
+    __atomic_store_n(&state.oneIn, oneIn ? oneIn : 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&state.perSecond, perSecond, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Start the thread writing the log to a file descriptor
+ *
+ * Messages written before are kept in the ring until then.
+ */
+void Log::start(int fd) {
+    g_fd = fd;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &Log::threadMain, NULL) == 0)
+        pthread_detach(thread);
+}
+
+/**
+ * @brief Check if a level is written, to skip building costly arguments
+ */
+bool Log::enabled(Level level) {
+    return static_cast<int>(level) >= __atomic_load_n(&g_level, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Check the sampling and rate limit of a category
+ * @return true if the message is kept
+ */
+static bool admit(CategoryState& state) {
+    unsigned int oneIn = __atomic_load_n(&state.oneIn, __ATOMIC_RELAXED);
+    if (oneIn > 1 && __atomic_fetch_add(&state.seen, 1, __ATOMIC_RELAXED) % oneIn != 0)
+        return false;
+
+    unsigned int perSecond = __atomic_load_n(&state.perSecond, __ATOMIC_RELAXED);
+    if (perSecond == 0)
+        return true;
+    // time() reads the vDSO clock: no system call. Two threads starting the
+    // same second both reset the count, which only lets a few more through.
+    long now = time(NULL);
+    long second = __atomic_load_n(&state.second, __ATOMIC_RELAXED);
+    if (second != now && __atomic_compare_exchange_n(&state.second, &second, now, false,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        __atomic_store_n(&state.inSecond, 0, __ATOMIC_RELAXED);
+    return __atomic_fetch_add(&state.inSecond, 1, __ATOMIC_RELAXED) < perSecond;
+}
+
+/**
+ * @brief Log a message (printf format); never blocks
+ *
+ * The message is dropped if its level is below the current one, if its
+ * category is over its sampling or rate limit, or if the ring is full.
+ */
+void Log::write(Level level, Category category, const char* format, ...) {
+    if (!enabled(level))
+        return;
+    CategoryState& state = g_categories[category];
+    if (!admit(state)) {
+        __atomic_fetch_add(&state.shed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    // Claim the next record, unless the drain thread has not read it yet
+    unsigned long position = __atomic_load_n(&g_tail, __ATOMIC_RELAXED);
+    Record* record;
+    unsigned long turn;
+    while (true) {
+        record = &g_ring[position & (CAPACITY - 1)];
+        turn = position / CAPACITY * 2;
+        unsigned long current = __atomic_load_n(&record->turn, __ATOMIC_ACQUIRE);
+        if (current == turn) {
+            if (__atomic_compare_exchange_n(&g_tail, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (static_cast<long>(current - turn) < 0) {
+            // Still holds the previous lap's message: the ring is full
+            __atomic_fetch_add(&g_dropped, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&g_droppedTotal, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            // Another producer took it first
+            position = __atomic_load_n(&g_tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(record->text, TEXT_SIZE, format, args);
+    va_end(args);
+    if (length < 0)
+        length = 0;
+    else if (length >= static_cast<int>(TEXT_SIZE))
+        length = TEXT_SIZE - 1;
+    record->length = static_cast<unsigned short>(length);
+    record->second = time(NULL);
+    record->level = static_cast<unsigned char>(level);
+    record->category = static_cast<unsigned char>(category);
+    __atomic_store_n(&record->turn, turn + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Get the number of messages lost because the ring was full
+ */
+unsigned long Log::dropped() {
+    return __atomic_load_n(&g_droppedTotal, __ATOMIC_RELAXED);
+}
+
+void* Log::threadMain(void*) {
+    drain(g_fd);
+    return NULL;
+}
+
+// Write a whole buffer; the log is lost if the descriptor fails
+static void writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        written += n;
+    }
+}
+
+// Format the timestamp of a second; localtime_r only runs when it changes
+static const char* timestamp(long second, long& cachedSecond, char* stamp, size_t size) {
+    if (second != cachedSecond) {
+        time_t value = second;
+        struct tm local;
+        localtime_r(&value, &local);
+        strftime(stamp, size, "%Y-%m-%d %H:%M:%S", &local);
+        cachedSecond = second;
+    }
+    return stamp;
+}
+
+/**
+ * @brief Drain thread: format the records in order and write them in batches
+ */
+void Log::drain(int fd) {
+    std::string batch;
+    batch.reserve(BATCH_SIZE + 512);
+    long stampSecond = -1;
+    char stamp[32] = "";
+    long reportSecond = time(NULL);
+    char line[96];
+
+    while (true) {
+        Record* record = &g_ring[g_head & (CAPACITY - 1)];
+        unsigned long turn = g_head / CAPACITY * 2 + 1;
+        if (__atomic_load_n(&record->turn, __ATOMIC_ACQUIRE) == turn) {
+            snprintf(line, sizeof(line), "%s %s %s: ", timestamp(record->second, stampSecond, stamp, sizeof(stamp)),
+                     LEVEL_NAMES[record->level], CATEGORY_NAMES[record->category]);
+            batch += line;
+            batch.append(record->text, record->length);
+            batch += '\n';
+            __atomic_store_n(&record->turn, turn + 1, __ATOMIC_RELEASE);
+            ++g_head;
+            if (batch.size() < BATCH_SIZE)
+                continue;
+        }
+
+        // Once a second, say how many messages were shed or dropped
+        long now = time(NULL);
+        if (now != reportSecond) {
+            reportSecond = now;
+            for (int i = 0; i < CAT_COUNT; ++i) {
+                unsigned long shed = __atomic_exchange_n(&g_categories[i].shed, 0, __ATOMIC_RELAXED);
+                if (shed) {
+                    snprintf(line, sizeof(line), "%s WARN %s: %lu messages suppressed\n",
+                             timestamp(now, stampSecond, stamp, sizeof(stamp)), CATEGORY_NAMES[i], shed);
+                    batch += line;
+                }
+            }
+            unsigned long dropped = __atomic_exchange_n(&g_dropped, 0, __ATOMIC_RELAXED);
+            if (dropped) {
+                snprintf(line, sizeof(line), "%s WARN server: %lu messages dropped (log buffer full)\n",
+                         timestamp(now, stampSecond, stamp, sizeof(stamp)), dropped);
+                batch += line;
+            }
+        }
+
+        if (!batch.empty()) {
+            writeAll(fd, batch);
+            batch.clear();
+        } else {
+            struct timespec idle;
+            idle.tv_sec = 0;
+            idle.tv_nsec = IDLE_NANOSECONDS;
+            nanosleep(&idle, NULL);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include "ircserv.hpp"
+
+/**
+ * @brief Asynchronous logger that never blocks the event loops
+ *
+ * Log::write() formats the message into a fixed-size record of a lock-free
+ * ring shared by all threads; a background thread started by Log::start()
+ * drains it, prefixes each line with a timestamp (formatted once per second)
+ * and writes batches to stderr. A thread that logs only pays for a vsnprintf
+ * and a few atomics: it never makes a system call, takes a lock or waits.
+ *
+ * Under a flood, messages are shed before they reach the ring: each category
+ * keeps one message in N (sampling) and at most a number of messages per
+ * second (rate limit). When the ring is full, new messages are dropped. The
+ * drain thread reports how many messages were shed or dropped.
+ */
+class Log {
+public:
+    enum Level {
+        LEVEL_DEBUG,
+        LEVEL_INFO,
+        LEVEL_WARN,
+        LEVEL_ERROR
+    };
+
+    enum Category {
+        CAT_SERVER,         // Startup and the event loops
+        CAT_CONNECTION,     // Connections accepted and closed
+        CAT_SENDQ,          // Clients dropped for not reading their replies
+        CAT_ADMIN,          // Metrics endpoint
+        CAT_COUNT
+    };
+
+    static bool parseLevel(const std::string& name, Level& level);
+    static void setLevel(Level level);
+    static void setSampling(Category category, unsigned int oneIn, unsigned int perSecond);
+    static void start(int fd);
+
+    static bool enabled(Level level);
+    static void write(Level level, Category category, const char* format, ...)
+        __attribute__((format(printf, 3, 4)));
+    static unsigned long dropped();
+
+private:
+    static void* threadMain(void* unused);
+    static void drain(int fd);
+};
+
+#endif
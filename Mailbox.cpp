@@ -0,0 +1,123 @@
+#include "Mailbox.hpp"
+#include "Payload.hpp"
+#include <fcntl.h>
+
+Mailbox::Mailbox() : _head(&_stub), _tail(&_stub), _stub(Mail::MAIL_FREE, NULL), _signalled(0) {
+    _wakeup[0] = -1;
+    _wakeup[1] = -1;
+}
+
+/**
+ * @brief Free undelivered mail and close the wakeup pipe
+ */
+Mailbox::~Mailbox() {
+    Mail* mail;
+    while ((mail = take()) != NULL) {
+        if (mail->payload)
+            mail->payload->release();
+        delete mail;
+    }
+    if (_wakeup[0] != -1)
+        close(_wakeup[0]);
+    if (_wakeup[1] != -1)
+        close(_wakeup[1]);
+}
+
+/**
+ * @brief Create the wakeup pipe
+ * @return false if the pipe could not be created
+ */
+bool Mailbox::open() {
+    if (pipe(_wakeup) == -1)
+        return false;
+    for (int i = 0; i < 2; ++i) {
+        if (fcntl(_wakeup[i], F_SETFL, O_NONBLOCK) == -1 || fcntl(_wakeup[i], F_SETFD, FD_CLOEXEC) == -1)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the descriptor that becomes readable when mail is posted
+ */
+int Mailbox::wakeupFd() const {
+    return _wakeup[0];
+}
+
+/**
+ * @brief Append a mail to the list
+ *
+ * Swapping the head publishes the mail to other producers; linking it from
+ * the previous head publishes it to the consumer. In between, take() sees
+ * the list as empty at that point, which the wakeup below makes up for.
+ */
+void Mailbox::push(Mail* mail) {
+    mail->next = NULL;
+    Mail* previous = __atomic_exchange_n(&_head, mail, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&previous->next, mail, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Hand a mail to the owning thread (any thread)
+ *
+ * The mailbox takes ownership of the mail, including its payload reference.
+ */
+void Mailbox::post(Mail* mail) {
+    push(mail);
+    if (__atomic_exchange_n(&_signalled, 1, __ATOMIC_SEQ_CST) == 0) {
+        char byte = 0;
+        ssize_t written = write(_wakeup[1], &byte, 1);
+        (void)written;  // A full pipe already guarantees a wakeup
+    }
+}
+
+/**
+ * @brief Consume the wakeup (owner only, before draining with take())
+ *
+ * Mail posted after this call triggers a new wakeup, so nothing posted while
+ * the owner drains the queue can be missed.
+ */
+void Mailbox::acknowledge() {
+    char buffer[64];
+    while (read(_wakeup[0], buffer, sizeof(buffer)) > 0)
+        ;
+    __atomic_store_n(&_signalled, 0, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Take the oldest mail (owner only)
+ * @return The mail, now owned by the caller, or NULL if none is ready
+ *
+ * Mail from one producer comes out in the order it was posted.
+ */
+Mail* Mailbox::take() {
+    Mail* tail = _tail;
+    Mail* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    // Skip the stub
+    if (tail == &_stub) {
+        if (next == NULL)
+            return NULL;
+        _tail = next;
+        tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL) {
+        _tail = next;
+        return tail;
+    }
+
+    // tail looks like the last mail; if a producer is still linking a newer
+    // one, wait for it (its post() wakes us up again)
+    if (tail != __atomic_load_n(&_head, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    // Put the stub back behind tail so tail can be handed out
+    push(&_stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        _tail = next;
+        return tail;
+    }
+    return NULL;
+}
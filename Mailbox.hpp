@@ -0,0 +1,76 @@
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+#include "ircserv.hpp"
+
+class Payload;
+class Mailbox;
+
+/**
+ * @brief One message passed between threads in multi-threaded mode
+ *
+ * IO threads send the hub what they read (new connections, lines, hangups);
+ * the hub sends back what to write and which connections to close.
+ */
+struct Mail {
+    enum Type {
+        MAIL_CONNECT,   // IO -> hub: accepted fd + hostname, reply to `replyTo`
+        MAIL_ATTACH,    // hub -> IO: start watching the client's socket
+        MAIL_LINE,      // IO -> hub: one received line in `text`
+        MAIL_TOO_LONG,  // IO -> hub: a line over the length limit was dropped
+        MAIL_HANGUP,    // IO -> hub: connection lost, reason in `text`
+        MAIL_OUTPUT,    // hub -> IO: queue `payload` for the client
+        MAIL_CLOSE,     // hub -> IO: flush and close the client's socket
+        MAIL_REGISTERED,// hub -> IO: the client registered (ends its registration deadline)
+        MAIL_FREE       // IO -> hub: the IO thread is done with the client
+    };
+
+    Mail* next;             // Link in the mailbox queue
+    Type type;
+    Client* client;
+    Payload* payload;       // MAIL_OUTPUT: one reference, owned by the mail
+    int fd;                 // MAIL_CONNECT
+    Mailbox* replyTo;       // MAIL_CONNECT: inbox of the IO thread
+    std::string text;       // Line, hostname or reason
+
+    Mail(Type t, Client* c) : next(NULL), type(t), client(c), payload(NULL), fd(-1), replyTo(NULL) {}
+};
+
+/**
+ * @brief Lock-free multi-producer, single-consumer queue of Mail
+ *
+ * Any thread may post(); only the owning thread calls take(). The queue is an
+ * intrusive linked list (Vyukov's MPSC design): posting is one atomic
+ * exchange, taking needs no atomic read-modify-write at all.
+ *
+ * The owner sleeps in its poller on wakeupFd(). A post only writes to the
+ * wakeup pipe when the owner hasn't been signalled since it last drained the
+ * queue, so a burst of mail costs a single write() and a single wakeup.
+ */
+class Mailbox {
+private:
+    Mail* _head;            // Last posted mail (producers)
+    Mail* _tail;            // Next mail to take (consumer)
+    Mail _stub;             // Keeps the list non-empty
+    int _wakeup[2];         // Pipe: [0] is watched by the owner, [1] is written by posters
+    int _signalled;         // 1 while a wakeup byte is pending
+
+    // Copying would break the list
+    Mailbox(const Mailbox& other);
+    Mailbox& operator=(const Mailbox& other);
+
+    void push(Mail* mail);
+
+public:
+    Mailbox();
+    ~Mailbox();
+
+    bool open();
+    int wakeupFd() const;
+
+    void post(Mail* mail);
+    void acknowledge();
+    Mail* take();
+};
+
+#endif
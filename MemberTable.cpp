@@ -0,0 +1,171 @@
+#include "MemberTable.hpp"
+
+// Slots allocated by the first insertion (must be a power of two)
+static const size_t INITIAL_CAPACITY = 16;
+
+/**
+ * @brief Hash a client handle
+ *
+ * Pool indexes are small and dense, so the bits are mixed before the table
+ * masks them.
+ */
+static size_t hashClient(const ClientHandle& client) {
+    size_t h = client.index ^ (static_cast<size_t>(client.generation) << 16);
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h;
+}
+
+MemberTable::MemberTable() : _entries(NULL), _capacity(0), _count(0) {}
+
+MemberTable::~MemberTable() {
+    delete[] _entries;
+}
+
+/**
+ * @brief Find the slot holding a client, or the free slot where it belongs
+ * @return Slot index (only valid while the table has a free slot)
+ */
+size_t MemberTable::slotOf(const ClientHandle& client) const {
+    size_t mask = _capacity - 1;
+    size_t slot = hashClient(client) & mask;
+    while (!_entries[slot].client.isNull() && _entries[slot].client != client)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+/**
+ * @brief Double the table and reinsert every entry
+ */
+void MemberTable::grow() {
+    Entry* old = _entries;
+    size_t oldCapacity = _capacity;
+
+    _capacity = oldCapacity ? oldCapacity * 2 : INITIAL_CAPACITY;
+    _entries = new Entry[_capacity];
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (!old[i].client.isNull())
+            _entries[slotOf(old[i].client)] = old[i];
+    }
+    delete[] old;
+}
+
+/**
+ * @brief Free a slot, shifting back entries displaced past it
+ *
+ * With linear probing an entry may only sit after its home slot, so every
+ * following entry of the cluster whose home is not between the hole and
+ * itself is moved into the hole. Lookups never need tombstones.
+ */
+void MemberTable::erase(size_t slot) {
+    size_t mask = _capacity - 1;
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+
+    while (!_entries[next].client.isNull()) {
+        size_t home = hashClient(_entries[next].client) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            _entries[hole] = _entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    _entries[hole].client = ClientHandle();
+    --_count;
+}
+
+/**
+ * @brief Get the mode bits of a client
+ * @return Combination of Mode values, 0 if the channel doesn't know the client
+ */
+unsigned int MemberTable::get(const ClientHandle& client) const {
+    if (_count == 0)
+        return 0;
+    const Entry& entry = _entries[slotOf(client)];
+    return entry.client.isNull() ? 0 : entry.modes;
+}
+
+/**
+ * @brief Set mode bits for a client, adding its entry if needed
+ *
+ * Setting MODE_MEMBER appends the client to the member array.
+ */
+void MemberTable::set(const ClientHandle& client, unsigned int modes) {
+    if ((_count + 1) * 4 > _capacity * 3)
+        grow();
+
+    Entry& entry = _entries[slotOf(client)];
+    if (entry.client.isNull()) {
+        entry.client = client;
+        entry.modes = 0;
+        entry.chunk = 0;
+        ++_count;
+    }
+    if ((modes & MODE_MEMBER) && !(entry.modes & MODE_MEMBER)) {
+        entry.index = _members.size();
+        _members.push_back(client);
+    }
+    entry.modes |= modes;
+}
+
+/**
+ * @brief Clear mode bits for a client, dropping its entry when none are left
+ *
+ * Clearing MODE_MEMBER moves the last member into the leaving client's place
+ * in the member array.
+ */
+void MemberTable::unset(const ClientHandle& client, unsigned int modes) {
+    if (_count == 0)
+        return;
+    size_t slot = slotOf(client);
+    Entry& entry = _entries[slot];
+    if (entry.client.isNull())
+        return;
+
+    if ((modes & MODE_MEMBER) && (entry.modes & MODE_MEMBER)) {
+        ClientHandle last = _members.back();
+        _members[entry.index] = last;
+        _entries[slotOf(last)].index = entry.index;
+        _members.pop_back();
+    }
+    entry.modes &= ~modes;
+    if (entry.modes == 0)
+        erase(slot);
+}
+
+/**
+ * @brief Get the NAMES chunk recorded for a client (0 if unknown)
+ */
+unsigned int MemberTable::getChunk(const ClientHandle& client) const {
+    if (_count == 0)
+        return 0;
+    const Entry& entry = _entries[slotOf(client)];
+    return entry.client.isNull() ? 0 : entry.chunk;
+}
+
+/**
+ * @brief Record which NAMES chunk lists a client that has an entry
+ */
+void MemberTable::setChunk(const ClientHandle& client, unsigned int chunk) {
+    if (_count == 0)
+        return;
+    Entry& entry = _entries[slotOf(client)];
+    if (!entry.client.isNull())
+        entry.chunk = chunk;
+}
+
+/**
+ * @brief Get the members, in no particular order
+ */
+const std::vector<ClientHandle>& MemberTable::members() const {
+    return _members;
+}
+
+/**
+ * @brief Get the number of entries (members and invited clients)
+ */
+size_t MemberTable::size() const {
+    return _count;
+}
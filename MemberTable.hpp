@@ -0,0 +1,64 @@
+#ifndef MEMBERTABLE_HPP
+#define MEMBERTABLE_HPP
+
+#include "ircserv.hpp"
+
+/**
+ * @brief Per-channel table of clients and their channel modes
+ *
+ * One entry per client known to the channel (member or invited), keyed by
+ * the client's handle and holding its mode bits, so membership, operator and
+ * invite checks are a single hash probe. Entries live in an open-addressed table
+ * with linear probing; removal shifts the following entries back instead of
+ * leaving tombstones.
+ *
+ * Members are also kept in a dense array for broadcasting. Each member's entry
+ * stores its index in that array, so leaving is a swap with the last member.
+ * Handles rather than pointers are stored, so a client freed without leaving
+ * resolves to NULL instead of dangling.
+ */
+class MemberTable {
+public:
+    enum Mode {
+        MODE_MEMBER = 1,        // On the channel
+        MODE_OP = 2,            // Channel operator (+o)
+        MODE_VOICE = 4,         // Voiced (+v)
+        MODE_INVITED = 8        // Invited, may join a +i channel
+    };
+
+private:
+    struct Entry {
+        ClientHandle client;    // Null for a free slot
+        unsigned int index;     // Position in _members, if MODE_MEMBER is set
+        unsigned int modes;     // Mode bits
+        unsigned int chunk;     // NAMES chunk listing the member (see NamesCache)
+    };
+
+    Entry* _entries;            // Hash table, capacity is a power of two
+    size_t _capacity;
+    size_t _count;              // Used slots
+    std::vector<ClientHandle> _members;
+
+    // Copying would duplicate the table, keep a single owner
+    MemberTable(const MemberTable& other);
+    MemberTable& operator=(const MemberTable& other);
+
+    size_t slotOf(const ClientHandle& client) const;
+    void grow();
+    void erase(size_t slot);
+
+public:
+    MemberTable();
+    ~MemberTable();
+
+    unsigned int get(const ClientHandle& client) const;
+    void set(const ClientHandle& client, unsigned int modes);
+    void unset(const ClientHandle& client, unsigned int modes);
+    unsigned int getChunk(const ClientHandle& client) const;
+    void setChunk(const ClientHandle& client, unsigned int chunk);
+
+    const std::vector<ClientHandle>& members() const;
+    size_t size() const;
+};
+
+#endif
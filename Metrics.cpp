@@ -0,0 +1,247 @@
+#include "Metrics.hpp"
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+
+// Bounds of the exported buckets; the histograms themselves are much finer
+static const unsigned long LATENCY_BOUNDS[] = {     // Nanoseconds, 1 us to 1 s
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+    1000000, 2000000, 5000000, 10000000, 20000000, 50000000, 100000000, 200000000, 500000000,
+    1000000000
+};
+static const unsigned long EVENT_BOUNDS[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256 };
+static const unsigned long SENDQ_BOUNDS[] = { 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576 };
+
+#define COUNT_OF(array) (sizeof(array) / sizeof((array)[0]))
+
+Histogram::Histogram() : _count(0), _sum(0) {
+    for (size_t i = 0; i < BUCKETS; ++i)
+        _counts[i] = 0;
+}
+
+/**
+ * @brief Get the bucket of a value
+ *
+ * Above EXACT, the bucket is given by the position of the highest set bit
+ * (which power of two) and the SUB_BITS bits below it (where in that range).
+ */
+size_t Histogram::bucketOf(unsigned long value) {
+    if (value < EXACT)
+        return value;
+    int msb = static_cast<int>(sizeof(unsigned long) * CHAR_BIT) - 1 - __builtin_clzl(value);
+    if (msb >= MAX_BITS)
+        return BUCKETS - 1;
+    int shift = msb - SUB_BITS;
+    return EXACT + (msb - SUB_BITS - 1) * (1 << SUB_BITS) + ((value >> shift) - (1 << SUB_BITS));
+}
+
+/**
+ * @brief Get the largest value that falls in a bucket
+ */
+unsigned long Histogram::upperBound(size_t bucket) {
+    if (bucket < EXACT)
+        return bucket;
+    if (bucket >= BUCKETS - 1)
+        return ULONG_MAX;
+    size_t group = (bucket - EXACT) >> SUB_BITS;
+    size_t sub = (bucket - EXACT) & ((1 << SUB_BITS) - 1);
+    int shift = static_cast<int>(group) + 1;
+    return ((((1UL << SUB_BITS) + sub) + 1) << shift) - 1;
+}
+
+/**
+ * @brief Count one value (owning thread only)
+ */
+void Histogram::record(unsigned long value) {
+    Metrics::add(_counts[bucketOf(value)], 1);
+    Metrics::add(_count, 1);
+    Metrics::add(_sum, value);
+}
+
+unsigned long Histogram::count() const {
+    return Metrics::read(_count);
+}
+
+unsigned long Histogram::sum() const {
+    return Metrics::read(_sum);
+}
+
+/**
+ * @brief Count the values at or below each bound
+ * @param bounds Increasing bounds
+ * @param counts Receives boundCount + 1 counts, the last one being the total
+ *
+ * A bucket is counted under the first bound that covers all of it, so a count
+ * may miss values a few percent below its bound. The total is the sum of the
+ * buckets read, which keeps the counts consistent while the owner records.
+ */
+void Histogram::cumulative(const unsigned long* bounds, size_t boundCount, unsigned long* counts) const {
+    size_t next = 0;
+    unsigned long total = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        unsigned long upper = upperBound(bucket);
+        while (next < boundCount && upper > bounds[next])
+            counts[next++] = total;
+        total += Metrics::read(_counts[bucket]);
+    }
+    while (next < boundCount)
+        counts[next++] = total;
+    counts[boundCount] = total;
+}
+
+IoMetrics::IoMetrics() : bytesIn(0), bytesOut(0), wakeups(0), events(0), accepted(0), closed(0),
+                         throttled(0), timeouts(0), deferred(0), writes(0),
+                         syscalls(0) {}
+
+CommandMetrics::CommandMetrics() {
+    for (size_t i = 0; i <= CMD_COUNT; ++i)
+        count[i] = 0;
+}
+
+/**
+ * @brief Get a monotonic timestamp in nanoseconds
+ */
+unsigned long Metrics::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long>(ts.tv_sec) * 1000000000UL + ts.tv_nsec;
+}
+
+void Metrics::writeFamily(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void Metrics::writeSample(std::string& out, const char* name, const std::string& labels, unsigned long value) {
+    char number[24];
+    snprintf(number, sizeof(number), "%lu", value);
+    out += name;
+    if (!labels.empty())
+        out += "{" + labels + "}";
+    out += ' ';
+    out += number;
+    out += '\n';
+}
+
+/**
+ * @brief Write the _bucket, _sum and _count samples of a histogram
+ * @param unit Recorded units per exported unit (e.g. 1e9 to export nanoseconds as seconds)
+ */
+void Metrics::writeHistogram(std::string& out, const char* name, const std::string& labels,
+                             const Histogram& histogram, const unsigned long* bounds, size_t boundCount,
+                             double unit) {
+    std::vector<unsigned long> counts(boundCount + 1);
+    histogram.cumulative(bounds, boundCount, &counts[0]);
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    char number[32];
+
+    for (size_t i = 0; i <= boundCount; ++i) {
+        if (i < boundCount)
+            snprintf(number, sizeof(number), "%.9g", bounds[i] / unit);
+        out += name;
+        out += "_bucket{" + prefix + "le=\"" + (i < boundCount ? number : "+Inf") + "\"} ";
+        snprintf(number, sizeof(number), "%lu", counts[i]);
+        out += number;
+        out += '\n';
+    }
+    snprintf(number, sizeof(number), "%.9g", histogram.sum() / unit);
+    out += name;
+    out += "_sum";
+    if (!labels.empty())
+        out += "{" + labels + "}";
+    out += ' ';
+    out += number;
+    out += '\n';
+    writeSample(out, (std::string(name) + "_count").c_str(), labels, counts[boundCount]);
+}
+
+/**
+ * @brief Write the per-command counters and dispatch latencies
+ */
+void Metrics::writeCommands(std::string& out, const CommandMetrics& commands) {
+    writeFamily(out, "ircserv_commands_total", "counter", "Commands dispatched.");
+    for (size_t i = 0; i <= CMD_COUNT; ++i) {
+        std::string labels = std::string("command=\"") + Command::name(static_cast<CommandId>(i)) + "\"";
+        writeSample(out, "ircserv_commands_total", labels, read(commands.count[i]));
+    }
+
+    writeFamily(out, "ircserv_command_duration_seconds", "histogram", "Time spent running a command.");
+    for (size_t i = 0; i <= CMD_COUNT; ++i) {
+        std::string labels = std::string("command=\"") + Command::name(static_cast<CommandId>(i)) + "\"";
+        writeHistogram(out, "ircserv_command_duration_seconds", labels, commands.latency[i],
+                       LATENCY_BOUNDS, COUNT_OF(LATENCY_BOUNDS), 1e9);
+    }
+}
+
+/**
+ * @brief Write the counters of every event loop, labelled by its index
+ */
+void Metrics::writeIo(std::string& out, const std::vector<const IoMetrics*>& loops) {
+    std::vector<std::string> labels;
+    for (size_t i = 0; i < loops.size(); ++i) {
+        char label[32];
+        snprintf(label, sizeof(label), "reactor=\"%lu\"", static_cast<unsigned long>(i));
+        labels.push_back(label);
+    }
+
+    static const struct {
+        const char* name;
+        const char* help;
+        unsigned long IoMetrics::* field;
+    } COUNTERS[] = {
+        { "ircserv_received_bytes_total", "Bytes read from clients.", &IoMetrics::bytesIn },
+        { "ircserv_sent_bytes_total", "Bytes written to clients.", &IoMetrics::bytesOut },
+        { "ircserv_write_calls_total", "Writes to clients (writev() calls or io_uring sends).", &IoMetrics::writes },
+        { "ircserv_io_syscalls_total", "System calls waiting for, accepting, reading and writing connections.",
+          &IoMetrics::syscalls },
+        { "ircserv_poll_wakeups_total", "Returns from the poller wait.", &IoMetrics::wakeups },
+        { "ircserv_poll_events_total", "Events returned by the poller.", &IoMetrics::events },
+        { "ircserv_connections_accepted_total", "Connections accepted.", &IoMetrics::accepted },
+        { "ircserv_connections_closed_total", "Connections closed.", &IoMetrics::closed },
+        { "ircserv_flood_throttled_total", "Times a client ran out of flood budget and stopped being read.",
+          &IoMetrics::throttled },
+        { "ircserv_connections_timed_out_total", "Connections dropped for missing the registration or ping deadline.",
+          &IoMetrics::timeouts },
+        { "ircserv_read_budget_deferred_total", "Times a client used up its read budget with input left.",
+          &IoMetrics::deferred }
+    };
+    for (size_t c = 0; c < COUNT_OF(COUNTERS); ++c) {
+        writeFamily(out, COUNTERS[c].name, "counter", COUNTERS[c].help);
+        for (size_t i = 0; i < loops.size(); ++i)
+            writeSample(out, COUNTERS[c].name, labels[i], read(loops[i]->*COUNTERS[c].field));
+    }
+
+    writeFamily(out, "ircserv_poll_events_per_wakeup", "histogram", "Events handled per poller wakeup.");
+    for (size_t i = 0; i < loops.size(); ++i)
+        writeHistogram(out, "ircserv_poll_events_per_wakeup", labels[i], loops[i]->eventsPerWakeup,
+                       EVENT_BOUNDS, COUNT_OF(EVENT_BOUNDS), 1);
+
+    writeFamily(out, "ircserv_sendq_bytes", "histogram", "Bytes queued for a client when it is flushed.");
+    for (size_t i = 0; i < loops.size(); ++i)
+        writeHistogram(out, "ircserv_sendq_bytes", labels[i], loops[i]->sendqDepth,
+                       SENDQ_BOUNDS, COUNT_OF(SENDQ_BOUNDS), 1);
+}
+
+/**
+ * @brief Write the memory the process has resident (Linux: /proc/self/statm)
+ */
+void Metrics::writeProcess(std::string& out) {
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm)
+        return;
+    if (fscanf(statm, "%lu %lu", &pages, &resident) == 2) {
+        writeFamily(out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.");
+        writeSample(out, "process_resident_memory_bytes", "", resident * sysconf(_SC_PAGESIZE));
+    }
+    fclose(statm);
+}
@@ -0,0 +1,108 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "ircserv.hpp"
+#include "Command.hpp"
+
+/**
+ * @brief Log-linear (HDR-style) histogram of non-negative integers
+ *
+ * Values below 64 have a bucket each; above that every power of two is split
+ * into 32 buckets, so any value is known within about 3% while the whole
+ * range up to 2^40 (18 minutes in nanoseconds) takes about 9 KB.
+ *
+ * Like every metric, a histogram has a single writer (the thread that owns
+ * it) and may be read at any time by the admin thread: updates are plain
+ * relaxed atomic stores, with no read-modify-write instruction.
+ */
+class Histogram {
+public:
+    static const int SUB_BITS = 5;
+    static const size_t EXACT = 2 << SUB_BITS;     // Values with their own bucket
+    static const int MAX_BITS = 40;                 // Larger values share the last bucket
+    static const size_t BUCKETS = EXACT + (MAX_BITS - SUB_BITS - 1) * (1 << SUB_BITS);
+
+private:
+    unsigned long _counts[BUCKETS];
+    unsigned long _count;
+    unsigned long _sum;
+
+    // Copying would be a torn snapshot
+    Histogram(const Histogram& other);
+    Histogram& operator=(const Histogram& other);
+
+    static size_t bucketOf(unsigned long value);
+
+public:
+    Histogram();
+
+    void record(unsigned long value);
+
+    unsigned long count() const;
+    unsigned long sum() const;
+    void cumulative(const unsigned long* bounds, size_t boundCount, unsigned long* counts) const;
+
+    static unsigned long upperBound(size_t bucket);
+};
+
+/**
+ * @brief Counters of one event loop (one per Reactor)
+ */
+struct IoMetrics {
+    unsigned long bytesIn;          // Bytes read from clients
+    unsigned long bytesOut;         // Bytes written to clients
+    unsigned long wakeups;          // Poller waits that returned events
+    unsigned long events;           // Events returned by those waits
+    unsigned long accepted;         // Connections accepted
+    unsigned long closed;           // Connections closed
+    unsigned long throttled;        // Times a client ran out of flood budget
+    unsigned long timeouts;         // Connections dropped for missing a registration or ping deadline
+    unsigned long deferred;         // Times a client's read budget ran out with input left
+    unsigned long writes;           // writev() calls (or io_uring sends) on client sockets
+    unsigned long syscalls;         // Poller waits, accepts, reads and writes (io_uring_enter() with io_uring)
+    Histogram eventsPerWakeup;
+    Histogram sendqDepth;           // Bytes queued for a client when it is flushed
+
+    IoMetrics();
+};
+
+/**
+ * @brief Commands dispatched and the time spent in their handlers
+ */
+struct CommandMetrics {
+    unsigned long count[CMD_COUNT + 1];     // Indexed by CommandId (CMD_UNKNOWN last)
+    Histogram latency[CMD_COUNT + 1];       // Nanoseconds per command
+
+    CommandMetrics();
+};
+
+/**
+ * @brief Metric updates and the Prometheus text exposition format
+ */
+class Metrics {
+public:
+    // Add to a counter owned by the calling thread (see Histogram)
+    static void add(unsigned long& counter, unsigned long amount) {
+        __atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+    }
+
+    // Read a counter from any thread
+    static unsigned long read(const unsigned long& counter) {
+        return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+    }
+
+    static unsigned long now();
+
+    static void writeCommands(std::string& out, const CommandMetrics& commands);
+    static void writeIo(std::string& out, const std::vector<const IoMetrics*>& loops);
+    static void writeProcess(std::string& out);
+
+private:
+    static void writeFamily(std::string& out, const char* name, const char* type, const char* help);
+    static void writeSample(std::string& out, const char* name, const std::string& labels, unsigned long value);
+    static void writeHistogram(std::string& out, const char* name, const std::string& labels,
+                               const Histogram& histogram, const unsigned long* bounds, size_t boundCount,
+                               double unit);
+};
+
+#endif
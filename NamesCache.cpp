@@ -0,0 +1,135 @@
+#include "NamesCache.hpp"
+
+// Longest IRC line, "\r\n" included (RFC 1459)
+static const size_t MAX_LINE = 512;
+
+// Room left for ":<server> 353 <nick> " in front of the cached body
+static const size_t REPLY_HEADER = 64;
+
+// Smallest chunk, so a channel with a very long name still lists a name per line
+static const size_t MIN_BUDGET = 64;
+
+NamesCache::NamesCache(const std::string& channelName) : _head("= " + channelName + " :") {
+    size_t reserved = REPLY_HEADER + _head.size() + 2;
+    _budget = reserved + MIN_BUDGET < MAX_LINE ? MAX_LINE - reserved : MIN_BUDGET;
+}
+
+NamesCache::~NamesCache() {
+    for (size_t i = 0; i < _chunks.size(); ++i)
+        invalidate(_chunks[i]);
+}
+
+/**
+ * @brief Drop the cached frame of a chunk that changed
+ */
+void NamesCache::invalidate(Chunk& chunk) {
+    if (chunk.frame) {
+        chunk.frame->release();  // Send queues still holding it keep their reference
+        chunk.frame = NULL;
+    }
+}
+
+/**
+ * @brief List a member's name
+ * @param client The member
+ * @param name Name with its prefix (e.g. "@alice")
+ * @return Number of the chunk the name went into
+ *
+ * The last chunk is tried first, so a join storm keeps appending to it; when
+ * it is full, the first chunk with room (e.g. emptied by parts) is reused.
+ */
+unsigned int NamesCache::add(const ClientHandle& client, const std::string& name) {
+    size_t index = _chunks.size();
+    if (index > 0 && _chunks[index - 1].text.size() + 1 + name.size() <= _budget) {
+        index = index - 1;
+    } else {
+        for (size_t i = 0; i < _chunks.size(); ++i) {
+            if (_chunks[i].text.empty() || _chunks[i].text.size() + 1 + name.size() <= _budget) {
+                index = i;
+                break;
+            }
+        }
+    }
+    if (index == _chunks.size()) {
+        _chunks.push_back(Chunk());
+        _chunks.back().frame = NULL;
+    }
+
+    Chunk& chunk = _chunks[index];
+    if (!chunk.text.empty())
+        chunk.text += ' ';
+    chunk.text += name;
+    chunk.clients.push_back(client);
+    chunk.lengths.push_back(name.size());
+    invalidate(chunk);
+    return static_cast<unsigned int>(index);
+}
+
+/**
+ * @brief Remove a member's name from the chunk it was added to
+ */
+void NamesCache::remove(unsigned int index, const ClientHandle& client) {
+    if (index >= _chunks.size())
+        return;
+    Chunk& chunk = _chunks[index];
+
+    // Find the name; its offset is the length of the names before it
+    size_t offset = 0;
+    size_t i = 0;
+    while (i < chunk.clients.size() && chunk.clients[i] != client) {
+        offset += chunk.lengths[i] + 1;
+        ++i;
+    }
+    if (i == chunk.clients.size())
+        return;
+
+    // Erase the name and one of the spaces around it
+    size_t length = chunk.lengths[i];
+    if (i + 1 < chunk.clients.size())
+        chunk.text.erase(offset, length + 1);
+    else if (i > 0)
+        chunk.text.erase(offset - 1, length + 1);
+    else
+        chunk.text.clear();
+    chunk.clients.erase(chunk.clients.begin() + i);
+    chunk.lengths.erase(chunk.lengths.begin() + i);
+    invalidate(chunk);
+}
+
+/**
+ * @brief Get the number of chunks, including empty ones
+ */
+size_t NamesCache::chunkCount() const {
+    return _chunks.size();
+}
+
+/**
+ * @brief Get the body of one RPL_NAMREPLY line
+ * @return "= <channel> :<names>\r\n", or NULL for an empty chunk
+ *
+ * The payload stays owned by the cache; retain it to keep it past the next
+ * change (queueing it in a SendQueue does).
+ */
+Payload* NamesCache::frame(size_t index) {
+    Chunk& chunk = _chunks[index];
+    if (chunk.text.empty())
+        return NULL;
+    if (!chunk.frame)
+        chunk.frame = Payload::createLine(_head + chunk.text);
+    return chunk.frame;
+}
+
+/**
+ * @brief Get every name, separated by spaces
+ */
+std::string NamesCache::list() const {
+    std::string names;
+    for (size_t i = 0; i < _chunks.size(); ++i) {
+        if (_chunks[i].text.empty())
+            continue;
+        if (!names.empty())
+            names += ' ';
+        names += _chunks[i].text;
+    }
+    return names;
+}
@@ -0,0 +1,52 @@
+#ifndef NAMESCACHE_HPP
+#define NAMESCACHE_HPP
+
+#include "ircserv.hpp"
+#include "Payload.hpp"
+
+/**
+ * @brief Names of a channel's members, pre-split into RPL_NAMREPLY lines
+ *
+ * The names ("@alice", "+bob", "carol") are kept in chunks small enough that
+ * ":<server> 353 <nick> = <channel> :<chunk>\r\n" fits in 512 bytes. Joining
+ * adds a name to a chunk with room, leaving removes it from its chunk, so a
+ * change only touches one chunk of at most a few hundred bytes instead of
+ * rebuilding the whole list.
+ *
+ * Each chunk also caches "= <channel> :<chunk>\r\n" as a sealed Payload that
+ * send queues can reference; it is rebuilt on the first NAMES after a change.
+ * Chunk numbers never change, so the caller can remember where each member is
+ * listed (the channel keeps it in its MemberTable). Emptied chunks are reused.
+ */
+class NamesCache {
+private:
+    struct Chunk {
+        std::string text;                   // Names separated by spaces
+        std::vector<ClientHandle> clients;  // Owner of each name, in the same order
+        std::vector<size_t> lengths;        // Length of each name
+        Payload* frame;                     // Cached reply body, NULL when stale
+    };
+
+    std::string _head;              // "= <channel> :"
+    size_t _budget;                 // Maximum bytes of names in one chunk
+    std::vector<Chunk> _chunks;
+
+    // Copying would share the cached frames
+    NamesCache(const NamesCache& other);
+    NamesCache& operator=(const NamesCache& other);
+
+    void invalidate(Chunk& chunk);
+
+public:
+    NamesCache(const std::string& channelName);
+    ~NamesCache();
+
+    unsigned int add(const ClientHandle& client, const std::string& name);
+    void remove(unsigned int chunk, const ClientHandle& client);
+
+    size_t chunkCount() const;
+    Payload* frame(size_t chunk);
+    std::string list() const;
+};
+
+#endif
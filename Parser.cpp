@@ -0,0 +1,137 @@
+#include "Parser.hpp"
+
+/**
+ * @brief Turn a token into a view of the line
+ */
+static StringRef view(const char* line, const Token& token) {
+    return StringRef(line + token.offset, token.length);
+}
+
+/**
+ * @brief Build a token from two positions
+ */
+static Token makeToken(size_t begin, size_t end) {
+    Token token;
+    token.offset = static_cast<unsigned short>(begin);
+    token.length = static_cast<unsigned short>(end - begin);
+    return token;
+}
+
+/**
+ * @brief Get the prefix (sender) of the message
+ * @return View of the prefix, empty if the message had none
+ */
+StringRef Message::getPrefix() const {
+    return view(line, prefix);
+}
+
+/**
+ * @brief Get the command name or numeric
+ */
+StringRef Message::getCommand() const {
+    return view(line, command);
+}
+
+/**
+ * @brief Get a parameter
+ * @param index Position of the parameter (0-based)
+ * @return View of the parameter, empty if index is out of range
+ */
+StringRef Message::getParam(unsigned int index) const {
+    if (index >= paramCount)
+        return StringRef();
+    return view(line, params[index]);
+}
+
+/**
+ * @brief Check if a command is made of letters only or is a 3-digit numeric
+ */
+static bool isValidCommand(const char* text, size_t length) {
+    bool letters = true;
+    bool digits = (length == 3);
+    for (size_t i = 0; i < length; ++i) {
+        char c = text[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')))
+            letters = false;
+        if (!(c >= '0' && c <= '9'))
+            digits = false;
+    }
+    return letters || digits;
+}
+
+/**
+ * @brief Split one line into prefix, command and parameters
+ * @param line The line, without "\r\n"
+ * @param length Number of characters in the line
+ * @param message Filled with tokens pointing into line
+ * @return PARSE_OK on success, otherwise the reason the line was rejected
+ *
+ * Runs of spaces between tokens are accepted. After 14 middle parameters the
+ * rest of the line is the 15th parameter even without ':' (RFC 2812).
+ */
+Parser::Result Parser::parse(const char* line, size_t length, Message& message) {
+    message.line = line;
+    message.prefix = makeToken(0, 0);
+    message.command = makeToken(0, 0);
+    message.paramCount = 0;
+    message.hasTrailing = false;
+
+    if (length > 0xFFFF)
+        return PARSE_TOO_LONG;
+
+    size_t pos = 0;
+    while (pos < length && line[pos] == ' ')
+        ++pos;
+    if (pos == length)
+        return PARSE_EMPTY;
+
+    // Optional prefix
+    if (line[pos] == ':') {
+        size_t begin = ++pos;
+        while (pos < length && line[pos] != ' ')
+            ++pos;
+        message.prefix = makeToken(begin, pos);
+        while (pos < length && line[pos] == ' ')
+            ++pos;
+        if (pos == length)
+            return PARSE_NO_COMMAND;
+    }
+
+    // Command
+    size_t begin = pos;
+    while (pos < length && line[pos] != ' ')
+        ++pos;
+    if (!isValidCommand(line + begin, pos - begin))
+        return PARSE_BAD_COMMAND;
+    message.command = makeToken(begin, pos);
+
+    // Parameters
+    while (true) {
+        while (pos < length && line[pos] == ' ')
+            ++pos;
+        if (pos == length)
+            break;
+
+        if (line[pos] == ':' || message.paramCount == Message::MAX_PARAMS - 1) {
+            if (line[pos] == ':') {
+                message.hasTrailing = true;
+                ++pos;
+            }
+            message.params[message.paramCount++] = makeToken(pos, length);
+            break;
+        }
+
+        begin = pos;
+        while (pos < length && line[pos] != ' ')
+            ++pos;
+        message.params[message.paramCount++] = makeToken(begin, pos);
+    }
+    return PARSE_OK;
+}
+
+/**
+ * @brief Parse a line given as a view (e.g. from Client::nextLine)
+ */
+Parser::Result Parser::parse(const StringRef& line, Message& message) {
+    return parse(line.data, line.length, message);
+}
@@ -0,0 +1,57 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include "StringRef.hpp"
+
+/**
+ * @brief Position of one token inside the parsed line
+ */
+struct Token {
+    unsigned short offset;  // Index of the first character in the line
+    unsigned short length;  // Number of characters
+};
+
+/**
+ * @brief One IRC message split into its parts
+ *
+ * The message does not own any text: every part is an offset/length pair into
+ * the line given to Parser::parse(), which must stay alive (and unchanged)
+ * while the message is used. Parsing never allocates memory.
+ *
+ * Format (RFC 1459): [":" prefix SPACE] command [params] "\r\n"
+ * The trailing parameter (after " :") is stored as the last entry of params
+ * and may contain spaces.
+ */
+struct Message {
+    static const unsigned int MAX_PARAMS = 15;
+
+    const char* line;               // Line the tokens point into
+    Token prefix;                   // Sender, without the leading ':' (may be empty)
+    Token command;                  // Command name or 3-digit numeric
+    Token params[MAX_PARAMS];       // Middle parameters, then the trailing one
+    unsigned int paramCount;        // Number of entries used in params
+    bool hasTrailing;               // true if the last param was introduced by ':'
+
+    StringRef getPrefix() const;
+    StringRef getCommand() const;
+    StringRef getParam(unsigned int index) const;
+};
+
+/**
+ * @brief Allocation-free IRC message parser
+ */
+class Parser {
+public:
+    enum Result {
+        PARSE_OK,
+        PARSE_EMPTY,            // Blank line, silently ignored by servers
+        PARSE_NO_COMMAND,       // Prefix without a command
+        PARSE_BAD_COMMAND,      // Command is neither letters nor 3 digits
+        PARSE_TOO_LONG          // Line does not fit the 16-bit offsets
+    };
+
+    static Result parse(const char* line, size_t length, Message& message);
+    static Result parse(const StringRef& line, Message& message);
+};
+
+#endif
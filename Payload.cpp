@@ -0,0 +1,147 @@
+#include "Payload.hpp"
+#include <cstring>
+#include <new>
+
+/**
+ * @brief Allocate a payload with room for capacity bytes
+ *
+ * The header and the data share one block: the data starts at _data and runs
+ * past the end of the declared array.
+ */
+Payload* Payload::allocate(size_t capacity) {
+    size_t header = offsetof(Payload, _data);
+    void* memory = ::operator new(header + (capacity ? capacity : 1));
+    Payload* payload = static_cast<Payload*>(memory);
+    payload->_refs = 1;
+    payload->_length = 0;
+    payload->_capacity = capacity;
+    payload->_sealed = false;
+    return payload;
+}
+
+/**
+ * @brief Serialize an IRC line once
+ * @param message The message without line terminator
+ * @return Sealed payload holding message + "\r\n", with one reference
+ */
+Payload* Payload::createLine(const std::string& message) {
+    return createLine(message.data(), message.length());
+}
+
+/**
+ * @brief Serialize an IRC line once from raw bytes
+ */
+Payload* Payload::createLine(const char* message, size_t length) {
+    Payload* payload = allocate(length + 2);
+    std::memcpy(payload->_data, message, length);
+    payload->_data[length] = '\r';
+    payload->_data[length + 1] = '\n';
+    payload->_length = length + 2;
+    payload->_sealed = true;
+    return payload;
+}
+
+/**
+ * @brief Copy bytes that already end with "\r\n" into a sealed payload
+ */
+Payload* Payload::createCopy(const char* bytes, size_t length) {
+    Payload* payload = allocate(length);
+    std::memcpy(payload->_data, bytes, length);
+    payload->_length = length;
+    payload->_sealed = true;
+    return payload;
+}
+
+/**
+ * @brief Create an empty private write buffer
+ * @param capacity Number of bytes it can hold
+ * @return Unsealed payload with one reference
+ */
+Payload* Payload::createBuffer(size_t capacity) {
+    return allocate(capacity);
+}
+
+/**
+ * @brief Add an owner
+ */
+void Payload::retain() {
+    __atomic_add_fetch(&_refs, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Drop an owner, freeing the payload when it was the last one
+ */
+void Payload::release() {
+    // Release so our writes happen before the free; acquire so the freeing
+    // thread sees everyone else's
+    if (__atomic_sub_fetch(&_refs, 1, __ATOMIC_ACQ_REL) == 0)
+        ::operator delete(this);
+}
+
+/**
+ * @brief Get the bytes of the payload
+ */
+const char* Payload::data() const {
+    return _data;
+}
+
+/**
+ * @brief Get the number of bytes in the payload
+ */
+size_t Payload::length() const {
+    return _length;
+}
+
+/**
+ * @brief Get the number of bytes that can still be appended
+ */
+size_t Payload::available() const {
+    return _sealed ? 0 : _capacity - _length;
+}
+
+/**
+ * @brief Check if more than one owner holds this payload
+ */
+bool Payload::isShared() const {
+    return __atomic_load_n(&_refs, __ATOMIC_RELAXED) > 1;
+}
+
+/**
+ * @brief Check if the payload is immutable
+ */
+bool Payload::isSealed() const {
+    return _sealed;
+}
+
+/**
+ * @brief Copy bytes at the end of an unsealed payload
+ * @param bytes The bytes to add
+ * @param count Number of bytes, must not exceed available()
+ */
+void Payload::append(const char* bytes, size_t count) {
+    std::memcpy(_data + _length, bytes, count);
+    _length += count;
+}
+
+/**
+ * @brief Get a pointer to the free space of an unsealed payload
+ *
+ * Write into it directly, then call commit() with the number of bytes written.
+ */
+char* Payload::tail() {
+    return _data + _length;
+}
+
+/**
+ * @brief Account for bytes written through tail()
+ */
+void Payload::commit(size_t count) {
+    _length += count;
+}
+
+/**
+ * @brief Make a filled buffer immutable so it can be shared
+ */
+void Payload::seal() {
+    _sealed = true;
+}
@@ -0,0 +1,61 @@
+#ifndef PAYLOAD_HPP
+#define PAYLOAD_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Reference-counted byte buffer shared between send queues
+ *
+ * A message sent to many clients (e.g. a channel PRIVMSG) is serialized once
+ * into a Payload, and every recipient's SendQueue keeps a reference to it
+ * instead of its own copy. The buffer is freed when the last queue lets go.
+ *
+ * The header and the bytes live in a single allocation. A sealed payload is
+ * immutable; an unsealed one is a private write buffer owned by one SendQueue,
+ * which may keep appending to it while it has spare capacity.
+ *
+ * In multi-threaded mode a sealed payload may be referenced from several
+ * threads' send queues, so the reference count is atomic.
+ */
+class Payload {
+private:
+    size_t _refs;       // Number of owners (updated atomically)
+    size_t _length;     // Bytes used
+    size_t _capacity;   // Bytes available in _data
+    bool _sealed;       // true once the payload may be shared
+    char _data[1];      // Bytes follow the header in the same allocation
+
+    Payload();
+    Payload(const Payload&);
+    Payload& operator=(const Payload&);
+    ~Payload();
+
+    static Payload* allocate(size_t capacity);
+
+public:
+    // Sealed payload holding a complete IRC line (message + "\r\n")
+    static Payload* createLine(const std::string& message);
+    static Payload* createLine(const char* message, size_t length);
+    // Sealed copy of bytes that are already framed
+    static Payload* createCopy(const char* bytes, size_t length);
+    // Unsealed, empty buffer to be filled with append()
+    static Payload* createBuffer(size_t capacity);
+
+    void retain();
+    void release();
+
+    const char* data() const;
+    size_t length() const;
+    size_t available() const;
+    bool isShared() const;
+    bool isSealed() const;
+
+    // Only valid on unsealed payloads
+    void append(const char* bytes, size_t count);
+    char* tail();
+    void commit(size_t count);
+    void seal();
+};
+
+#endif
@@ -0,0 +1,288 @@
+#include "Poller.hpp"
+#include <cerrno>
+#ifdef __linux__
+# include <sys/epoll.h>
+# include <unistd.h>
+#endif
+
+/**
+ * @brief Virtual destructor so backends are cleaned up through a Poller*
+ */
+Poller::~Poller() {
+}
+
+/**
+ * @brief Create a poller for the requested backend
+ * @param backend The preferred backend
+ * @return A new poller (owned by the caller), never NULL
+ *
+ * If epoll is requested but unavailable (non-Linux system or epoll_create
+ * failing), we fall back to the portable poll() backend. io_uring is run
+ * without a Poller: asking for it here gets its fallback, epoll.
+ */
+Poller* Poller::create(Backend backend) {
+#ifdef __linux__
+    if (backend == BACKEND_EPOLL || backend == BACKEND_URING) {
+        EpollPoller* poller = new EpollPoller();
+        if (poller->isOpen())
+            return poller;
+        delete poller;
+    }
+#else
+    (void)backend;
+#endif
+    return new PollPoller();
+}
+
+/**
+ * @brief Convert a backend name ("epoll", "poll" or "io_uring") to its enum value
+ * @param name The backend name
+ * @param backend Reference to store the result
+ * @return true if the name is known, false otherwise
+ */
+bool Poller::parseBackend(const std::string& name, Backend& backend) {
+    if (name == "epoll") {
+        backend = BACKEND_EPOLL;
+        return true;
+    }
+    if (name == "poll") {
+        backend = BACKEND_POLL;
+        return true;
+    }
+    if (name == "io_uring") {
+        backend = BACKEND_URING;
+        return true;
+    }
+    return false;
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Translate EV_* interest bits to epoll flags
+ *
+ * EPOLLET makes the registration edge-triggered: the kernel reports a socket
+ * once when it becomes ready instead of on every epoll_wait while it stays ready.
+ */
+static unsigned int toEpollEvents(unsigned int interest) {
+    unsigned int events = EPOLLET | EPOLLRDHUP;
+    if (interest & Poller::EV_READ) events |= EPOLLIN;
+    if (interest & Poller::EV_WRITE) events |= EPOLLOUT;
+    return events;
+}
+
+/**
+ * @brief Constructor for EpollPoller, creates the epoll instance
+ */
+EpollPoller::EpollPoller() : _epfd(epoll_create1(EPOLL_CLOEXEC)) {
+}
+
+/**
+ * @brief Destructor for EpollPoller, closes the epoll instance
+ */
+EpollPoller::~EpollPoller() {
+    if (_epfd != -1)
+        close(_epfd);
+}
+
+/**
+ * @brief Check if the epoll instance was created successfully
+ * @return true if usable, false otherwise
+ */
+bool EpollPoller::isOpen() const {
+    return _epfd != -1;
+}
+
+/**
+ * @brief Register a file descriptor
+ * @param fd The file descriptor to watch
+ * @param data Pointer stored in epoll_data and returned with every event
+ * @param interest EV_READ and/or EV_WRITE
+ * @return true on success, false on error
+ */
+bool EpollPoller::add(int fd, void* data, unsigned int interest) {
+    struct epoll_event ev;
+    ev.events = toEpollEvents(interest);
+    ev.data.ptr = data;
+    return epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+/**
+ * @brief Change the interest set of a registered file descriptor
+ */
+bool EpollPoller::modify(int fd, void* data, unsigned int interest) {
+    struct epoll_event ev;
+    ev.events = toEpollEvents(interest);
+    ev.data.ptr = data;
+    return epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+/**
+ * @brief Unregister a file descriptor
+ *
+ * Closing an fd removes it from epoll automatically, but doing it explicitly
+ * keeps things correct if the fd was dup()ed somewhere.
+ */
+void EpollPoller::remove(int fd) {
+    struct epoll_event ev;  // Ignored, but required by kernels before 2.6.9
+    epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+/**
+ * @brief Wait for ready file descriptors
+ *
+ * Only ready sockets are returned by the kernel, so the cost of this call does
+ * not depend on the number of idle connections.
+ */
+int EpollPoller::wait(Event* events, int maxEvents, int timeoutMs) {
+    if (_raw.size() < maxEvents * sizeof(struct epoll_event))
+        _raw.resize(maxEvents * sizeof(struct epoll_event));
+    struct epoll_event* raw = reinterpret_cast<struct epoll_event*>(&_raw[0]);
+
+    int count = epoll_wait(_epfd, raw, maxEvents, timeoutMs);
+    if (count == -1)
+        return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < count; ++i) {
+        unsigned int flags = 0;
+        if (raw[i].events & EPOLLIN) flags |= EV_READ;
+        if (raw[i].events & EPOLLOUT) flags |= EV_WRITE;
+        if (raw[i].events & EPOLLERR) flags |= EV_ERROR;
+        if (raw[i].events & (EPOLLHUP | EPOLLRDHUP)) flags |= EV_HANGUP;
+        events[i].data = raw[i].data.ptr;
+        events[i].events = flags;
+    }
+    return count;
+}
+
+const char* EpollPoller::name() const {
+    return "epoll";
+}
+
+bool EpollPoller::isEdgeTriggered() const {
+    return true;
+}
+
+#endif
+
+/**
+ * @brief Translate EV_* interest bits to poll() flags
+ */
+static short toPollEvents(unsigned int interest) {
+    short events = 0;
+    if (interest & Poller::EV_READ) events |= POLLIN;
+    if (interest & Poller::EV_WRITE) events |= POLLOUT;
+    return events;
+}
+
+/**
+ * @brief Constructor for PollPoller
+ */
+PollPoller::PollPoller() : _cursor(0) {
+}
+
+/**
+ * @brief Destructor for PollPoller
+ */
+PollPoller::~PollPoller() {
+}
+
+/**
+ * @brief Register a file descriptor
+ * @return false if the fd is invalid or already registered
+ */
+bool PollPoller::add(int fd, void* data, unsigned int interest) {
+    if (fd < 0)
+        return false;
+    if (static_cast<size_t>(fd) >= _slotOfFd.size())
+        _slotOfFd.resize(fd + 1, -1);
+    if (_slotOfFd[fd] != -1)
+        return false;
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = toPollEvents(interest);
+    pfd.revents = 0;
+    _slotOfFd[fd] = static_cast<int>(_fds.size());
+    _fds.push_back(pfd);
+    _data.push_back(data);
+    return true;
+}
+
+/**
+ * @brief Change the interest set of a registered file descriptor
+ */
+bool PollPoller::modify(int fd, void* data, unsigned int interest) {
+    if (fd < 0 || static_cast<size_t>(fd) >= _slotOfFd.size() || _slotOfFd[fd] == -1)
+        return false;
+    int slot = _slotOfFd[fd];
+    _fds[slot].events = toPollEvents(interest);
+    _data[slot] = data;
+    return true;
+}
+
+/**
+ * @brief Unregister a file descriptor
+ *
+ * The last entry is moved into the freed slot so the array stays dense and the
+ * removal is O(1).
+ */
+void PollPoller::remove(int fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= _slotOfFd.size() || _slotOfFd[fd] == -1)
+        return;
+    size_t slot = _slotOfFd[fd];
+    size_t last = _fds.size() - 1;
+    if (slot != last) {
+        _fds[slot] = _fds[last];
+        _data[slot] = _data[last];
+        _slotOfFd[_fds[slot].fd] = static_cast<int>(slot);
+    }
+    _fds.pop_back();
+    _data.pop_back();
+    _slotOfFd[fd] = -1;
+}
+
+/**
+ * @brief Wait for ready file descriptors
+ *
+ * poll() reports readiness inside the pollfd array, so we have to walk all of
+ * it. The scan resumes where the previous one stopped when more fds are ready
+ * than fit in the events array, so no fd is starved.
+ */
+int PollPoller::wait(Event* events, int maxEvents, int timeoutMs) {
+    if (_fds.empty())
+        return 0;
+
+    int ready = poll(&_fds[0], _fds.size(), timeoutMs);
+    if (ready == -1)
+        return errno == EINTR ? 0 : -1;
+
+    int count = 0;
+    size_t total = _fds.size();
+    if (_cursor >= total)
+        _cursor = 0;
+    for (size_t n = 0; n < total && count < ready && count < maxEvents; ++n) {
+        size_t i = (_cursor + n) % total;
+        short revents = _fds[i].revents;
+        if (revents == 0)
+            continue;
+        unsigned int flags = 0;
+        if (revents & POLLIN) flags |= EV_READ;
+        if (revents & POLLOUT) flags |= EV_WRITE;
+        if (revents & (POLLERR | POLLNVAL)) flags |= EV_ERROR;
+        if (revents & POLLHUP) flags |= EV_HANGUP;
+        events[count].data = _data[i];
+        events[count].events = flags;
+        ++count;
+        _cursor = i + 1;
+    }
+    return count;
+}
+
+const char* PollPoller::name() const {
+    return "poll";
+}
+
+bool PollPoller::isEdgeTriggered() const {
+    return false;
+}
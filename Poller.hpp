@@ -0,0 +1,120 @@
+#ifndef POLLER_HPP
+#define POLLER_HPP
+
+#include <poll.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Readiness notification backend for the server event loop
+ *
+ * A Poller watches a set of file descriptors and reports the ones that are
+ * ready. Every registered fd carries an opaque pointer (usually the Client it
+ * belongs to) that is handed back with each event, so the event loop never has
+ * to look the fd up again.
+ *
+ * Two backends exist:
+ * - epoll (Linux): edge-triggered, the kernel only returns ready sockets, so a
+ *   wakeup costs O(ready) no matter how many idle clients are connected.
+ * - poll (portable fallback): level-triggered, every wakeup scans all fds.
+ *
+ * With an edge-triggered backend the caller must drain a socket (read/accept
+ * until EAGAIN) before waiting again, otherwise it will not be notified again.
+ *
+ * BACKEND_URING is not a Poller: io_uring reports completed I/O rather than
+ * readiness, so the event loop drives it directly. create() treats it as
+ * epoll, which is what the event loop falls back to without kernel support.
+ */
+class Poller {
+public:
+    enum Backend {
+        BACKEND_EPOLL,
+        BACKEND_POLL,
+        BACKEND_URING           // Completion based, run by the event loop itself (see IoUring)
+    };
+
+    // Interest / event bits
+    enum {
+        EV_READ = 1 << 0,       // Data (or a connection) can be read
+        EV_WRITE = 1 << 1,      // Socket accepts more data
+        EV_ERROR = 1 << 2,      // Error condition on the socket
+        EV_HANGUP = 1 << 3      // Peer closed the connection
+    };
+
+    struct Event {
+        void* data;             // Pointer given to add()/modify()
+        unsigned int events;    // EV_* bits that fired
+    };
+
+    virtual ~Poller();
+
+    // Register, update or unregister a file descriptor
+    virtual bool add(int fd, void* data, unsigned int interest) = 0;
+    virtual bool modify(int fd, void* data, unsigned int interest) = 0;
+    virtual void remove(int fd) = 0;
+
+    // Wait up to timeoutMs (-1 = forever) and fill at most maxEvents events.
+    // Returns the number of events, 0 on timeout or -1 on error.
+    virtual int wait(Event* events, int maxEvents, int timeoutMs) = 0;
+
+    virtual const char* name() const = 0;
+    virtual bool isEdgeTriggered() const = 0;
+
+    // Factory: returns the requested backend, or poll if it is not available
+    static Poller* create(Backend backend);
+    static bool parseBackend(const std::string& name, Backend& backend);
+};
+
+#ifdef __linux__
+/**
+ * @brief Edge-triggered epoll backend (Linux only)
+ */
+class EpollPoller : public Poller {
+private:
+    int _epfd;              // epoll instance file descriptor
+    std::vector<char> _raw; // Scratch space for struct epoll_event results
+
+    EpollPoller(const EpollPoller&);
+    EpollPoller& operator=(const EpollPoller&);
+
+public:
+    EpollPoller();
+    virtual ~EpollPoller();
+
+    bool isOpen() const;
+
+    virtual bool add(int fd, void* data, unsigned int interest);
+    virtual bool modify(int fd, void* data, unsigned int interest);
+    virtual void remove(int fd);
+    virtual int wait(Event* events, int maxEvents, int timeoutMs);
+    virtual const char* name() const;
+    virtual bool isEdgeTriggered() const;
+};
+#endif
+
+/**
+ * @brief Level-triggered poll() backend, available everywhere
+ *
+ * The pollfd array is kept dense: removing an fd moves the last entry into its
+ * slot, and _slotOfFd maps an fd to its position so add/modify/remove are O(1).
+ */
+class PollPoller : public Poller {
+private:
+    std::vector<struct pollfd> _fds;    // Dense array passed to poll()
+    std::vector<void*> _data;           // User pointer for each _fds entry
+    std::vector<int> _slotOfFd;         // fd -> index in _fds, or -1
+    size_t _cursor;                     // Where the next scan resumes
+
+public:
+    PollPoller();
+    virtual ~PollPoller();
+
+    virtual bool add(int fd, void* data, unsigned int interest);
+    virtual bool modify(int fd, void* data, unsigned int interest);
+    virtual void remove(int fd);
+    virtual int wait(Event* events, int maxEvents, int timeoutMs);
+    virtual const char* name() const;
+    virtual bool isEdgeTriggered() const;
+};
+
+#endif
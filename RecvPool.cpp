@@ -0,0 +1,51 @@
+#include "RecvPool.hpp"
+
+/**
+ * @brief Constructor for RecvPool, chunks are allocated when first needed
+ * @param chunkSize Bytes per chunk
+ */
+RecvPool::RecvPool(size_t chunkSize) : _chunkSize(chunkSize), _inUse(0) {
+}
+
+/**
+ * @brief Destructor for RecvPool, every chunk must have been released
+ */
+RecvPool::~RecvPool() {
+    for (size_t i = 0; i < _idle.size(); ++i)
+        delete[] _idle[i];
+}
+
+/**
+ * @brief Get a chunk of chunkSize() bytes (contents undefined)
+ */
+char* RecvPool::acquire() {
+    ++_inUse;
+    if (_idle.empty())
+        return new char[_chunkSize];
+    char* chunk = _idle.back();
+    _idle.pop_back();
+    return chunk;
+}
+
+/**
+ * @brief Give back a chunk from acquire(); kept for reuse or freed
+ */
+void RecvPool::release(char* chunk) {
+    --_inUse;
+    if (_idle.size() < MAX_IDLE)
+        _idle.push_back(chunk);
+    else
+        delete[] chunk;
+}
+
+size_t RecvPool::chunkSize() const {
+    return _chunkSize;
+}
+
+size_t RecvPool::inUse() const {
+    return _inUse;
+}
+
+size_t RecvPool::idle() const {
+    return _idle.size();
+}
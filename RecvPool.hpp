@@ -0,0 +1,45 @@
+#ifndef RECVPOOL_HPP
+#define RECVPOOL_HPP
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Fixed-size receive chunks shared by the line buffers of one event loop
+ *
+ * A client only needs input memory while it holds part of a line: between
+ * turns almost every connection has consumed all it received. Line buffers
+ * take a chunk from the pool to read into and hand it back as soon as they
+ * are empty, so idle connections hold none, and the chunks in use follow the
+ * number of clients with unfinished input rather than the number connected.
+ *
+ * Up to a few released chunks are kept for the next reads instead of being
+ * freed, so a busy loop doesn't allocate at all. A pool belongs to one
+ * thread (its Reactor) and is not locked.
+ */
+class RecvPool {
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 16384;
+    static const size_t MAX_IDLE = 64;      // Released chunks kept for reuse
+
+private:
+    size_t _chunkSize;
+    std::vector<char*> _idle;   // Released chunks, reused last in first out
+    size_t _inUse;              // Chunks handed out and not released
+
+    RecvPool(const RecvPool&);
+    RecvPool& operator=(const RecvPool&);
+
+public:
+    explicit RecvPool(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    ~RecvPool();
+
+    char* acquire();
+    void release(char* chunk);
+
+    size_t chunkSize() const;
+    size_t inUse() const;
+    size_t idle() const;
+};
+
+#endif
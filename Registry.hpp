@@ -0,0 +1,185 @@
+#ifndef REGISTRY_HPP
+#define REGISTRY_HPP
+
+#include <string>
+#include <vector>
+#include "CaseMap.hpp"
+
+/**
+ * @brief Server-wide index of objects by case-insensitive name
+ *
+ * Used for nicknames and channel names. Each entry stores the RFC 1459 folded
+ * name, computed once when the entry is added, and its hash, so growing the
+ * table never folds or hashes a name again and lookups only compare keys
+ * whose hashes match.
+ *
+ * The table uses open addressing with linear probing, and removal shifts the
+ * following entries back instead of leaving tombstones. Lookups fold the
+ * queried name on the fly and don't allocate. The registry doesn't own the
+ * objects it points to.
+ */
+template <typename T>
+class Registry {
+private:
+    struct Entry {
+        T* value;               // NULL for a free slot
+        size_t hash;            // CaseMap::hash() of the name
+        std::string key;        // Folded name
+    };
+
+    std::vector<Entry> _entries;    // Capacity is a power of two
+    size_t _count;
+
+    // Slots allocated by the first insertion
+    static const size_t INITIAL_CAPACITY = 16;
+
+    /**
+     * @brief Find the slot holding a name, or the free slot where it belongs
+     */
+    size_t slotOf(const char* name, size_t length, size_t hash) const {
+        size_t mask = _entries.size() - 1;
+        size_t slot = hash & mask;
+        while (_entries[slot].value != NULL) {
+            const Entry& entry = _entries[slot];
+            if (entry.hash == hash && CaseMap::equals(name, length, entry.key))
+                break;
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    /**
+     * @brief Double the table, moving keys instead of copying them
+     */
+    void grow() {
+        std::vector<Entry> old;
+        old.swap(_entries);
+        _entries.resize(old.empty() ? INITIAL_CAPACITY : old.size() * 2);
+        for (size_t i = 0; i < _entries.size(); ++i)
+            _entries[i].value = NULL;
+
+        size_t mask = _entries.size() - 1;
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (old[i].value == NULL)
+                continue;
+            size_t slot = old[i].hash & mask;
+            while (_entries[slot].value != NULL)
+                slot = (slot + 1) & mask;   // Keys are unique, no need to compare
+            _entries[slot].value = old[i].value;
+            _entries[slot].hash = old[i].hash;
+            _entries[slot].key.swap(old[i].key);
+        }
+    }
+
+    /**
+     * @brief Free a slot, shifting back entries displaced past it
+     */
+    void erase(size_t slot) {
+        size_t mask = _entries.size() - 1;
+        size_t hole = slot;
+        size_t next = (hole + 1) & mask;
+
+        while (_entries[next].value != NULL) {
+            size_t home = _entries[next].hash & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                _entries[hole].value = _entries[next].value;
+                _entries[hole].hash = _entries[next].hash;
+                _entries[hole].key.swap(_entries[next].key);
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        _entries[hole].value = NULL;
+        _entries[hole].key.clear();
+        --_count;
+    }
+
+public:
+    Registry() : _count(0) {}
+
+    /**
+     * @brief Look up a name, in any case
+     * @return The object, or NULL if the name is not registered
+     */
+    T* find(const char* name, size_t length) const {
+        if (_count == 0)
+            return NULL;
+        return _entries[slotOf(name, length, CaseMap::hash(name, length))].value;
+    }
+
+    T* find(const std::string& name) const {
+        return find(name.data(), name.length());
+    }
+
+    /**
+     * @brief Register a name
+     * @return false if the name (in any case) is already taken
+     */
+    bool insert(const std::string& name, T* value) {
+        if ((_count + 1) * 4 > _entries.size() * 3)
+            grow();
+
+        size_t hash = CaseMap::hash(name.data(), name.length());
+        Entry& entry = _entries[slotOf(name.data(), name.length(), hash)];
+        if (entry.value != NULL)
+            return false;
+        entry.value = value;
+        entry.hash = hash;
+        entry.key = CaseMap::fold(name);
+        ++_count;
+        return true;
+    }
+
+    /**
+     * @brief Unregister a name
+     * @return The object that was registered, or NULL
+     */
+    T* remove(const char* name, size_t length) {
+        if (_count == 0)
+            return NULL;
+        size_t slot = slotOf(name, length, CaseMap::hash(name, length));
+        T* value = _entries[slot].value;
+        if (value != NULL)
+            erase(slot);
+        return value;
+    }
+
+    T* remove(const std::string& name) {
+        return remove(name.data(), name.length());
+    }
+
+    /**
+     * @brief Move an object to a new name (e.g. a nick change)
+     * @return false if the old name isn't registered or the new one belongs to another object
+     */
+    bool rename(const std::string& from, const std::string& to) {
+        if (_count == 0)
+            return false;
+        size_t slot = slotOf(from.data(), from.length(), CaseMap::hash(from.data(), from.length()));
+        T* value = _entries[slot].value;
+        if (value == NULL)
+            return false;
+        if (CaseMap::equals(to.data(), to.length(), _entries[slot].key))
+            return true;    // Only the case changed, the key stays the same
+        if (find(to) != NULL)
+            return false;
+        erase(slot);
+        return insert(to, value);
+    }
+
+    size_t size() const {
+        return _count;
+    }
+
+    /**
+     * @brief Append every registered object to a vector
+     */
+    void values(std::vector<T*>& out) const {
+        for (size_t i = 0; i < _entries.size(); ++i) {
+            if (_entries[i].value != NULL)
+                out.push_back(_entries[i].value);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include "SendQueue.hpp"
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+// Copied messages are packed into private buffers of this many bytes
+static const size_t CHUNK_SIZE = 4096;
+
+// Slots of the ring when the first chunk is queued; it doubles when full
+static const unsigned int INITIAL_CHUNKS = 8;
+
+// Maximum number of iovecs handed to one writev() call: as many as the kernel
+// takes, so the lines of many broadcasts (one shared payload each) still go
+// out with a single system call
+#ifdef IOV_MAX
+static const int MAX_IOV = IOV_MAX;
+#else
+static const int MAX_IOV = 1024;
+#endif
+
+/**
+ * @brief Constructor for SendQueue, starts empty
+ */
+SendQueue::SendQueue() : _chunks(NULL), _head(0), _count(0), _capacity(0), _offset(0), _size(0) {
+}
+
+/**
+ * @brief Destructor for SendQueue, drops its payload references
+ */
+SendQueue::~SendQueue() {
+    clear();
+}
+
+/**
+ * @brief Get a queued chunk by position (0 is the oldest)
+ */
+Payload* SendQueue::chunk(unsigned int index) const {
+    return _chunks[(_head + index) & (_capacity - 1)];
+}
+
+/**
+ * @brief Add a chunk at the end of the ring, growing it when full
+ */
+void SendQueue::pushChunk(Payload* payload) {
+    if (_count == _capacity) {
+        unsigned int capacity = _capacity ? _capacity * 2 : INITIAL_CHUNKS;
+        Payload** chunks = new Payload*[capacity];
+        for (unsigned int i = 0; i < _count; ++i)
+            chunks[i] = chunk(i);
+        delete[] _chunks;
+        _chunks = chunks;
+        _capacity = capacity;
+        _head = 0;
+    }
+    _chunks[(_head + _count) & (_capacity - 1)] = payload;
+    ++_count;
+}
+
+/**
+ * @brief Remove the oldest chunk (its reference is the caller's to drop);
+ *        the ring is freed once empty
+ */
+void SendQueue::popChunk() {
+    _head = (_head + 1) & (_capacity - 1);
+    if (--_count == 0) {
+        delete[] _chunks;
+        _chunks = NULL;
+        _capacity = 0;
+        _head = 0;
+    }
+}
+
+/**
+ * @brief Copy data at the end of the queue
+ * @param data Bytes to send
+ * @param length Number of bytes
+ *
+ * If the last chunk is our own buffer with enough room the data is appended
+ * to it, otherwise a new buffer is started.
+ */
+void SendQueue::append(const char* data, size_t length) {
+    if (length == 0)
+        return;
+    std::memcpy(reserve(length), data, length);
+}
+
+/**
+ * @brief Make room for bytes at the end of the queue
+ * @param length Number of bytes the caller will write
+ * @return Where to write them; they are queued as soon as this returns
+ *
+ * Lets a message be formatted directly into the queue instead of being built
+ * in a temporary and copied by append().
+ */
+char* SendQueue::reserve(size_t length) {
+    if (_count == 0 || chunk(_count - 1)->available() < length)
+        pushChunk(Payload::createBuffer(length > CHUNK_SIZE ? length : CHUNK_SIZE));
+    Payload* last = chunk(_count - 1);
+    char* out = last->tail();
+    last->commit(length);
+    _size += length;
+    return out;
+}
+
+/**
+ * @brief Queue a shared payload without copying it
+ * @param payload Sealed payload; the queue takes its own reference
+ */
+void SendQueue::push(Payload* payload) {
+    if (payload->length() == 0)
+        return;
+    payload->retain();
+    pushChunk(payload);
+    _size += payload->length();
+}
+
+/**
+ * @brief Write as much queued data as the socket accepts
+ * @param fd The client socket
+ * @param writes If not NULL, incremented for every writev() call made
+ * @return FLUSH_DONE, FLUSH_AGAIN (retry when writable) or FLUSH_ERROR
+ *
+ * writev() sends several chunks with a single system call. A short write
+ * means the socket buffer is full, so we stop there instead of making
+ * another call that would only return EAGAIN.
+ */
+SendQueue::FlushResult SendQueue::flush(int fd, unsigned long* writes) {
+    while (_size > 0) {
+        struct iovec iov[MAX_IOV];
+        size_t batch = 0;
+        int count = gather(iov, NULL, MAX_IOV, &batch);
+
+        ssize_t written = writev(fd, iov, count);
+        if (writes)
+            ++*writes;
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return FLUSH_AGAIN;
+            return FLUSH_ERROR;
+        }
+        consume(static_cast<size_t>(written));
+
+        if (static_cast<size_t>(written) < batch)
+            return FLUSH_AGAIN;
+    }
+    return FLUSH_DONE;
+}
+
+/**
+ * @brief Describe the front of the queue for a vectored write
+ * @param iov Filled with one entry per chunk
+ * @param chunks If not NULL, filled with the payload behind each entry (not
+ *               retained: a caller writing asynchronously must retain them)
+ * @param max Maximum number of entries
+ * @param bytes If not NULL, set to the number of bytes described
+ * @return Number of entries filled
+ *
+ * Nothing is removed: call consume() with what was actually written.
+ */
+int SendQueue::gather(struct iovec* iov, Payload** chunks, int max, size_t* bytes) const {
+    int count = 0;
+    size_t total = 0;
+    for (; static_cast<unsigned int>(count) < _count && count < max; ++count) {
+        Payload* payload = chunk(count);
+        size_t skip = (count == 0) ? _offset : 0;
+        iov[count].iov_base = const_cast<char*>(payload->data() + skip);
+        iov[count].iov_len = payload->length() - skip;
+        total += iov[count].iov_len;
+        if (chunks)
+            chunks[count] = payload;
+    }
+    if (bytes)
+        *bytes = total;
+    return count;
+}
+
+/**
+ * @brief Drop bytes that were written from the front of the queue
+ * @param length Number of bytes (more than queued drops everything, e.g. if
+ *               the queue was cleared while an asynchronous write was in flight)
+ */
+void SendQueue::consume(size_t length) {
+    if (length >= _size) {
+        clear();
+        return;
+    }
+    // Drop fully written chunks and remember where the next one starts
+    _size -= length;
+    while (length > 0) {
+        size_t left = chunk(0)->length() - _offset;
+        if (length < left) {
+            _offset += length;
+            break;
+        }
+        length -= left;
+        chunk(0)->release();
+        popChunk();
+        _offset = 0;
+    }
+}
+
+/**
+ * @brief Drop everything still waiting to be sent
+ */
+void SendQueue::clear() {
+    for (unsigned int i = 0; i < _count; ++i)
+        chunk(i)->release();
+    delete[] _chunks;
+    _chunks = NULL;
+    _head = _count = _capacity = 0;
+    _offset = 0;
+    _size = 0;
+}
+
+/**
+ * @brief Get the number of bytes waiting to be sent
+ */
+size_t SendQueue::size() const {
+    return _size;
+}
+
+/**
+ * @brief Check if there is nothing to send
+ */
+bool SendQueue::empty() const {
+    return _size == 0;
+}
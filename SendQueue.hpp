@@ -0,0 +1,70 @@
+#ifndef SENDQUEUE_HPP
+#define SENDQUEUE_HPP
+
+#include <cstddef>
+#include <string>
+#include "Payload.hpp"
+
+struct iovec;
+
+/**
+ * @brief Outgoing data waiting to be written to one client's socket
+ *
+ * Messages are appended to the queue instead of being sent immediately, and
+ * the event loop flushes the queue with writev() when the socket is writable.
+ * A partial write keeps the unsent bytes at the front of the queue, so nothing
+ * is lost when the kernel buffer is full.
+ *
+ * The queue holds references to Payloads. A broadcast shares one sealed
+ * payload between all recipients; other messages are copied into a private
+ * buffer at the tail, so a burst of short lines is written with a handful of
+ * iovecs. One writev() takes up to IOV_MAX of them, so a flush is a single
+ * system call however many broadcasts were queued during the iteration.
+ * gather() and consume() split a flush in two, for a write that completes
+ * later (io_uring).
+ *
+ * The references are kept in a ring that is freed whenever the queue drains,
+ * so the queue of an idle client holds no memory (a std::deque allocates
+ * more than half a kilobyte as soon as it is constructed).
+ */
+class SendQueue {
+public:
+    enum FlushResult {
+        FLUSH_DONE,         // Everything was written
+        FLUSH_AGAIN,        // Socket buffer is full, wait for writability
+        FLUSH_ERROR         // Connection is broken
+    };
+
+private:
+    Payload** _chunks;                  // Pending data (one reference each), a ring; NULL while empty
+    unsigned int _head;                 // Index of the oldest chunk
+    unsigned int _count;                // Chunks queued
+    unsigned int _capacity;             // Slots in _chunks (a power of two)
+    size_t _offset;                     // Bytes of the front chunk already sent
+    size_t _size;                       // Total bytes waiting to be sent
+
+public:
+    SendQueue();
+    ~SendQueue();
+
+    void append(const char* data, size_t length);
+    char* reserve(size_t length);
+    void push(Payload* payload);
+    FlushResult flush(int fd, unsigned long* writes = NULL);
+    int gather(struct iovec* iov, Payload** chunks, int max, size_t* bytes = NULL) const;
+    void consume(size_t length);
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
+
+private:
+    SendQueue(const SendQueue&);
+    SendQueue& operator=(const SendQueue&);
+
+    Payload* chunk(unsigned int index) const;
+    void pushChunk(Payload* payload);
+    void popChunk();
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef SLABPOOL_HPP
+#define SLABPOOL_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/**
+ * @brief Generation-checked reference to an object in a SlabPool
+ *
+ * A handle names a pool slot and the generation the slot had when the object
+ * was created. Destroying the object bumps the generation, so an old handle
+ * resolves to NULL instead of to whatever reuses the slot. Generation 0 is
+ * never used, so a default-constructed handle is null.
+ */
+template <typename T>
+struct Handle {
+    unsigned int index;
+    unsigned int generation;
+
+    Handle() : index(0), generation(0) {}
+    Handle(unsigned int i, unsigned int g) : index(i), generation(g) {}
+
+    bool isNull() const { return generation == 0; }
+    bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Fixed-size slab allocator for one class of objects
+ *
+ * Objects are constructed in place in slots carved out of slabs of
+ * SLAB_SLOTS slots. Freed slots go on a free list and are reused most recent
+ * first, so churn (e.g. a reconnect storm) doesn't touch malloc once the
+ * slabs exist, and live objects stay packed together. Slabs are only
+ * released when the pool is destroyed, so object addresses never move.
+ */
+template <typename T, size_t SLAB_SLOTS = 256>
+class SlabPool {
+private:
+    // Slot storage comes first so an object's address is its slot's address
+    struct Slot {
+        union {
+            char bytes[sizeof(T)];
+            void* alignPointer;
+            long alignLong;
+            double alignDouble;
+        } storage;
+        unsigned int index;         // Position of this slot in the pool
+        unsigned int generation;    // Bumped each time the slot is freed
+        unsigned int nextFree;      // Next free slot, if this one is free
+        bool live;                  // Holds a constructed object
+    };
+
+    static const unsigned int NO_SLOT = ~0u;
+
+    std::vector<Slot*> _slabs;
+    unsigned int _freeHead;         // Most recently freed slot, or NO_SLOT
+    size_t _live;
+
+    // Copying would duplicate the objects' ownership
+    SlabPool(const SlabPool& other);
+    SlabPool& operator=(const SlabPool& other);
+
+    Slot& slotAt(unsigned int index) const {
+        return _slabs[index / SLAB_SLOTS][index % SLAB_SLOTS];
+    }
+
+    static Slot* slotOf(const T* object) {
+        return reinterpret_cast<Slot*>(const_cast<T*>(object));
+    }
+
+    /**
+     * @brief Take a free slot, adding a slab when none is left
+     */
+    Slot& acquire() {
+        if (_freeHead == NO_SLOT) {
+            unsigned int base = static_cast<unsigned int>(_slabs.size() * SLAB_SLOTS);
+            Slot* slab = new Slot[SLAB_SLOTS];
+            for (unsigned int i = 0; i < SLAB_SLOTS; ++i) {
+                slab[i].index = base + i;
+                slab[i].generation = 1;
+                slab[i].live = false;
+                slab[i].nextFree = (i + 1 < SLAB_SLOTS) ? base + i + 1 : NO_SLOT;
+            }
+            _slabs.push_back(slab);
+            _freeHead = base;
+        }
+        Slot& slot = slotAt(_freeHead);
+        _freeHead = slot.nextFree;
+        return slot;
+    }
+
+    T* commit(Slot& slot) {
+        slot.live = true;
+        ++_live;
+        return reinterpret_cast<T*>(slot.storage.bytes);
+    }
+
+public:
+    SlabPool() : _freeHead(NO_SLOT), _live(0) {}
+
+    ~SlabPool() {
+        for (size_t s = 0; s < _slabs.size(); ++s) {
+            for (size_t i = 0; i < SLAB_SLOTS; ++i) {
+                if (_slabs[s][i].live)
+                    reinterpret_cast<T*>(_slabs[s][i].storage.bytes)->~T();
+            }
+            delete[] _slabs[s];
+        }
+    }
+
+    /**
+     * @brief Construct an object in a free slot
+     */
+    template <typename A1>
+    T* create(const A1& a1) {
+        Slot& slot = acquire();
+        try {
+            new (slot.storage.bytes) T(a1);
+        } catch (...) {
+            slot.nextFree = _freeHead;
+            _freeHead = slot.index;
+            throw;
+        }
+        return commit(slot);
+    }
+
+    template <typename A1, typename A2>
+    T* create(const A1& a1, const A2& a2) {
+        Slot& slot = acquire();
+        try {
+            new (slot.storage.bytes) T(a1, a2);
+        } catch (...) {
+            slot.nextFree = _freeHead;
+            _freeHead = slot.index;
+            throw;
+        }
+        return commit(slot);
+    }
+
+    /**
+     * @brief Destroy an object and free its slot; its handles become stale
+     */
+    void destroy(T* object) {
+        if (object == NULL)
+            return;
+        Slot* slot = slotOf(object);
+        object->~T();
+        slot->live = false;
+        if (++slot->generation == 0)
+            slot->generation = 1;
+        slot->nextFree = _freeHead;
+        _freeHead = slot->index;
+        --_live;
+    }
+
+    /**
+     * @brief Get the handle of a live object
+     */
+    Handle<T> handleOf(const T* object) const {
+        const Slot* slot = slotOf(object);
+        return Handle<T>(slot->index, slot->generation);
+    }
+
+    /**
+     * @brief Resolve a handle
+     * @return The object, or NULL if it was destroyed since the handle was taken
+     */
+    T* get(const Handle<T>& handle) const {
+        if (handle.index >= _slabs.size() * SLAB_SLOTS)
+            return NULL;
+        Slot& slot = slotAt(handle.index);
+        if (!slot.live || slot.generation != handle.generation)
+            return NULL;
+        return reinterpret_cast<T*>(slot.storage.bytes);
+    }
+
+    size_t size() const {
+        return _live;
+    }
+};
+
+#endif
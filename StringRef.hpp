@@ -0,0 +1,51 @@
+#ifndef STRINGREF_HPP
+#define STRINGREF_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief Non-owning view of a run of characters (C++98 stand-in for string_view)
+ *
+ * A StringRef points into a buffer owned by someone else, so it is only valid
+ * as long as that buffer is not modified. Use str() to take a copy.
+ */
+struct StringRef {
+    const char* data;
+    size_t length;
+
+    StringRef() : data(NULL), length(0) {}
+    StringRef(const char* d, size_t len) : data(d), length(len) {}
+
+    bool empty() const { return length == 0; }
+    char operator[](size_t i) const { return data[i]; }
+    std::string str() const { return std::string(data, length); }
+
+    bool operator==(const char* other) const {
+        return std::strlen(other) == length && std::memcmp(data, other, length) == 0;
+    }
+};
+
+// Concatenation, so views can be used where messages are built from strings
+inline std::string operator+(const std::string& left, const StringRef& right) {
+    std::string result(left);
+    return result.append(right.data, right.length);
+}
+
+inline std::string operator+(const char* left, const StringRef& right) {
+    std::string result(left);
+    return result.append(right.data, right.length);
+}
+
+inline std::string operator+(const StringRef& left, const std::string& right) {
+    std::string result(left.data, left.length);
+    return result.append(right);
+}
+
+inline std::string operator+(const StringRef& left, const char* right) {
+    std::string result(left.data, left.length);
+    return result.append(right);
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include "TimerWheel.hpp"
+#include <climits>
+
+// Ticks covered by all the levels; later deadlines are clamped to this
+static const unsigned long SPAN = 1UL << (TimerWheel::LEVELS * TimerWheel::SLOT_BITS);
+
+/**
+ * @brief Constructor
+ * @param now Current time in milliseconds (monotonic)
+ * @param tickMs Resolution: deadlines are rounded up to a tick
+ */
+TimerWheel::TimerWheel(unsigned long now, unsigned long tickMs)
+    : _tickMs(tickMs), _current(now / tickMs), _count(0) {
+    for (int i = 0; i < LEVELS * SLOTS; ++i)
+        _slots[i] = NULL;
+    for (int level = 0; level < LEVELS; ++level)
+        _occupied[level] = 0;
+}
+
+/**
+ * @brief Put a timer in the slot matching its expiry, relative to now
+ */
+void TimerWheel::link(Timer& timer) {
+    unsigned long delay = timer.expiry - _current;
+    int level = 0;
+    while (level < LEVELS - 1 && delay >= (1UL << ((level + 1) * SLOT_BITS)))
+        ++level;
+    unsigned int index = (timer.expiry >> (level * SLOT_BITS)) & (SLOTS - 1);
+    unsigned int slot = level * SLOTS + index;
+
+    timer.slot = slot;
+    timer.prev = NULL;
+    timer.next = _slots[slot];
+    if (timer.next)
+        timer.next->prev = &timer;
+    _slots[slot] = &timer;
+    _occupied[level] |= 1ULL << index;
+}
+
+/**
+ * @brief Take a timer out of its slot
+ */
+void TimerWheel::unlink(Timer& timer) {
+    if (timer.prev)
+        timer.prev->next = timer.next;
+    else
+        _slots[timer.slot] = timer.next;
+    if (timer.next)
+        timer.next->prev = timer.prev;
+    if (_slots[timer.slot] == NULL)
+        _occupied[timer.slot / SLOTS] &= ~(1ULL << (timer.slot % SLOTS));
+    timer.prev = timer.next = NULL;
+}
+
+/**
+ * @brief Arm a timer, or move it if it is already pending
+ * @param when Deadline in milliseconds; a past one fires at the next tick
+ */
+void TimerWheel::schedule(Timer& timer, unsigned long when) {
+    if (timer.pending)
+        unlink(timer);
+    else
+        ++_count;
+    unsigned long tick = (when + _tickMs - 1) / _tickMs;
+    if (tick <= _current)
+        tick = _current + 1;
+    else if (tick - _current >= SPAN)
+        tick = _current + SPAN - 1;
+    timer.expiry = tick;
+    timer.pending = true;
+    link(timer);
+}
+
+/**
+ * @brief Disarm a timer; does nothing if it is not pending
+ */
+void TimerWheel::cancel(Timer& timer) {
+    if (!timer.pending)
+        return;
+    unlink(timer);
+    timer.pending = false;
+    --_count;
+}
+
+/**
+ * @brief Move the timers of the current slot of a level down the wheel
+ */
+void TimerWheel::cascade(int level) {
+    unsigned int index = (_current >> (level * SLOT_BITS)) & (SLOTS - 1);
+    unsigned int slot = level * SLOTS + index;
+    Timer* timer = _slots[slot];
+    _slots[slot] = NULL;
+    _occupied[level] &= ~(1ULL << index);
+    while (timer) {
+        Timer* next = timer->next;
+        link(*timer);
+        timer = next;
+    }
+}
+
+/**
+ * @brief Process the ticks up to now
+ * @param expired Receives the timers that are due; they are no longer pending
+ *
+ * Call it on every loop iteration, even with no timer pending: schedule()
+ * places deadlines relative to the last tick processed. An empty wheel jumps
+ * straight to now.
+ */
+void TimerWheel::advance(unsigned long now, std::vector<Timer*>& expired) {
+    unsigned long target = now / _tickMs;
+    if (_count == 0) {
+        if (target > _current)
+            _current = target;
+        return;
+    }
+
+    while (_current < target) {
+        ++_current;
+        // Entering a new round of a level pulls the matching slot of the
+        // level above down, before this tick's slot is read
+        for (int level = 1; level < LEVELS; ++level) {
+            if ((_current & ((1UL << (level * SLOT_BITS)) - 1)) != 0)
+                break;
+            cascade(level);
+        }
+
+        unsigned int slot = _current & (SLOTS - 1);
+        Timer* timer = _slots[slot];
+        _slots[slot] = NULL;
+        _occupied[0] &= ~(1ULL << slot);
+        while (timer) {
+            Timer* next = timer->next;
+            timer->prev = timer->next = NULL;
+            timer->pending = false;
+            --_count;
+            expired.push_back(timer);
+            timer = next;
+        }
+    }
+}
+
+/**
+ * @brief Get the time of the next tick that has work (a timer due or a cascade)
+ * @return Milliseconds (monotonic), or ULONG_MAX if no timer is pending
+ *
+ * A cascade is not an expiry, so the answer may be early, never late.
+ */
+unsigned long TimerWheel::nextExpiry() const {
+    unsigned long next = ULONG_MAX;
+    for (int level = 0; level < LEVELS; ++level) {
+        if (_occupied[level] == 0)
+            continue;
+        // First occupied slot after the current one, going round the level
+        int shift = level * SLOT_BITS;
+        unsigned long position = _current >> shift;
+        unsigned int start = (position + 1) & (SLOTS - 1);
+        unsigned long long rotated = (_occupied[level] >> start) |
+                                     (start ? _occupied[level] << (SLOTS - start) : 0);
+        unsigned long distance = __builtin_ctzll(rotated) + 1;
+        unsigned long tick = (position + distance) << shift;
+        if (tick < next)
+            next = tick;
+    }
+    return next == ULONG_MAX ? next : next * _tickMs;
+}
+
+/**
+ * @brief Get the number of pending timers
+ */
+size_t TimerWheel::size() const {
+    return _count;
+}
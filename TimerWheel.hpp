@@ -0,0 +1,68 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief A deadline, embedded in the object it belongs to
+ *
+ * The wheel links pending timers into its slots through prev/next, so
+ * scheduling and cancelling never allocate. `data` is handed back untouched
+ * (like the data pointer of a Poller event).
+ */
+struct Timer {
+    Timer* prev;
+    Timer* next;
+    unsigned long expiry;       // Tick at which it fires
+    unsigned int slot;          // Slot holding it while pending
+    bool pending;
+    void* data;
+
+    Timer() : prev(NULL), next(NULL), expiry(0), slot(0), pending(false), data(NULL) {}
+};
+
+/**
+ * @brief Hierarchical timing wheel
+ *
+ * LEVELS wheels of SLOTS slots each: level 0 has one slot per tick, level 1
+ * one per SLOTS ticks, and so on. A timer goes into the level whose range
+ * covers its delay, and is moved down a level ("cascaded") when the lower
+ * wheel comes round to it, so schedule() and cancel() are O(1) and advance()
+ * only touches timers that are due or being cascaded.
+ *
+ * Each level keeps a bitmap of its non-empty slots: nextExpiry() finds the
+ * next tick that has work with a few bit scans, never by walking the timers.
+ * With 100 ms ticks the wheel spans 19 days; later deadlines are clamped.
+ */
+class TimerWheel {
+public:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+
+private:
+    unsigned long _tickMs;
+    unsigned long _current;                     // Last tick processed
+    Timer* _slots[LEVELS * SLOTS];              // Head of each slot's list
+    unsigned long long _occupied[LEVELS];       // Bit i set if slot i of the level is non-empty
+    size_t _count;                              // Pending timers
+
+    TimerWheel(const TimerWheel&);
+    TimerWheel& operator=(const TimerWheel&);
+
+    void link(Timer& timer);
+    void unlink(Timer& timer);
+    void cascade(int level);
+
+public:
+    TimerWheel(unsigned long now, unsigned long tickMs);
+
+    void schedule(Timer& timer, unsigned long when);
+    void cancel(Timer& timer);
+    void advance(unsigned long now, std::vector<Timer*>& expired);
+    unsigned long nextExpiry() const;
+    size_t size() const;
+};
+
+#endif
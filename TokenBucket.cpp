@@ -0,0 +1,41 @@
+#include "TokenBucket.hpp"
+
+TokenBucket::TokenBucket() : _level(0), _stamp(0) {
+}
+
+/**
+ * @brief Refill the bucket for the time elapsed, then take a cost out of it
+ * @param cost Units needed
+ * @param now Current time in milliseconds (monotonic)
+ * @param rate Units added per second
+ * @param burst Capacity of the bucket, in units
+ * @return true if the bucket held enough (and was charged), false otherwise
+ */
+bool TokenBucket::take(unsigned int cost, unsigned long now, unsigned int rate, unsigned int burst) {
+    unsigned long capacity = burst * 1000UL;
+    if (_stamp == 0) {
+        _level = capacity;          // A new client starts with a full bucket
+    } else if (now > _stamp) {
+        // One unit per second is one thousandth per millisecond
+        unsigned long refill = (now - _stamp) * rate;
+        _level = (capacity - _level > refill) ? _level + refill : capacity;
+    }
+    _stamp = now;
+
+    unsigned long needed = cost * 1000UL;
+    if (_level < needed)
+        return false;
+    _level -= needed;
+    return true;
+}
+
+/**
+ * @brief Get the time at which take() will succeed for a cost
+ * @return A time in milliseconds, comparable with the `now` given to take()
+ */
+unsigned long TokenBucket::readyAt(unsigned int cost, unsigned int rate) const {
+    unsigned long needed = cost * 1000UL;
+    if (_level >= needed || rate == 0)
+        return _stamp;
+    return _stamp + (needed - _level + rate - 1) / rate;
+}
@@ -0,0 +1,27 @@
+#ifndef TOKENBUCKET_HPP
+#define TOKENBUCKET_HPP
+
+/**
+ * @brief Flood control budget of one client
+ *
+ * The bucket holds up to `burst` units and refills at `rate` units per
+ * second; every command takes its cost out of it (see Command::cost()). The
+ * level is kept in thousandths of a unit and the refill computed from the
+ * elapsed milliseconds, so the arithmetic is exact with integers only.
+ *
+ * The rate and burst are passed on each call rather than stored: they are
+ * the same for every client, and the bucket stays two words.
+ */
+class TokenBucket {
+private:
+    unsigned long _level;       // Thousandths of a unit available
+    unsigned long _stamp;       // Time of the last refill, in milliseconds (0: never used)
+
+public:
+    TokenBucket();
+
+    bool take(unsigned int cost, unsigned long now, unsigned int rate, unsigned int burst);
+    unsigned long readyAt(unsigned int cost, unsigned int rate) const;
+};
+
+#endif
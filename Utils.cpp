@@ -2,7 +2,48 @@
 #include "Client.hpp"
 #include <sys/time.h>
 #include <climits>     // For INT_MAX and INT_MIN
-#include <iomanip>     // For setfill and setw
+#include <cstring>
+
+// Every numeric code as its 3-digit string ("000" to "999"), built by the
+// compiler so formatting a reply never converts a number at run time
+#define CODES_1(p) p "0", p "1", p "2", p "3", p "4", p "5", p "6", p "7", p "8", p "9"
+#define CODES_10(p) CODES_1(p "0"), CODES_1(p "1"), CODES_1(p "2"), CODES_1(p "3"), CODES_1(p "4"), \
+                    CODES_1(p "5"), CODES_1(p "6"), CODES_1(p "7"), CODES_1(p "8"), CODES_1(p "9")
+static const char CODE_STRINGS[1000][4] = {
+    CODES_10("0"), CODES_10("1"), CODES_10("2"), CODES_10("3"), CODES_10("4"),
+    CODES_10("5"), CODES_10("6"), CODES_10("7"), CODES_10("8"), CODES_10("9")
+};
+#undef CODES_10
+#undef CODES_1
+
+// ":<server name> ", set once by setServerName() and copied in front of every reply
+static std::string serverPrefix;
+
+/**
+ * @brief Get the 3-digit string of a numeric code
+ */
+static const char* codeString(int code) {
+    return CODE_STRINGS[static_cast<unsigned int>(code) % 1000];
+}
+
+/**
+ * @brief Write "<prefix><code> <target> <message>" and return the end
+ *
+ * The caller provides exactly prefixLength + 5 + target + message bytes.
+ */
+static char* writeReply(char* out, const char* prefix, size_t prefixLength, int code,
+                        const StringRef& target, const std::string& message) {
+    std::memcpy(out, prefix, prefixLength);
+    out += prefixLength;
+    std::memcpy(out, codeString(code), 3);
+    out[3] = ' ';
+    out += 4;
+    std::memcpy(out, target.data, target.length);
+    out += target.length;
+    *out++ = ' ';
+    std::memcpy(out, message.data(), message.size());
+    return out + message.size();
+}
 
 /**
  * @brief Split a string by a delimiter
@@ -85,43 +126,49 @@ std::string Utils::toLower(const std::string& str) {
  * @param message The message to send
  * @return true if successful, false if failed
  * 
- * send() is a system function that sends data over a socket.
- * It returns the number of bytes sent, or -1 on error.
+ * The message is added to the client's send queue; the event loop writes it
+ * when the socket is writable, so partial writes and EAGAIN never lose data.
+ * false means the client exceeded its sendq limit and will be disconnected.
  */
 bool Utils::sendToClient(Client* client, const std::string& message) {
     if (!client) return false;
     
     std::string fullMessage = message + "\r\n";  // IRC messages end with \r\n
-    
-    // send(socket, data, length, flags)
-    // On macOS, MSG_NOSIGNAL is not available. Using 0 for flags.
-    // For robust SIGPIPE handling on macOS, SO_NOSIGPIPE socket option should be set elsewhere.
-    ssize_t bytesSent = send(client->getFd(), fullMessage.c_str(), fullMessage.length(), 0);
-    
-    if (bytesSent < 0) {
-        std::cerr << "Error sending to client: " << strerror(errno) << std::endl;
-        return false;
-    }
-    
-    if (static_cast<size_t>(bytesSent) != fullMessage.length()) {
-        std::cerr << "Warning: Partial send to client" << std::endl;
-        return false;
-    }
-    
-    return true;
+    return client->queueOutput(fullMessage);
+}
+
+/**
+ * @brief Send an already serialized line to a client
+ * @param client Pointer to the client
+ * @param frame Sealed payload from Payload::createLine()
+ * @return true if successful, false if failed
+ *
+ * The client's send queue keeps a reference to the frame instead of copying
+ * it, so the same frame can be sent to many clients for the cost of one.
+ */
+bool Utils::sendToClient(Client* client, Payload* frame) {
+    if (!client || !frame) return false;
+    return client->queueOutput(frame);
 }
 
 /**
  * @brief Get current timestamp as string
  * @return Timestamp string
+ *
+ * Each thread keeps the last string it formatted, so localtime_r only runs
+ * when the second changes.
  */
 std::string Utils::getTimestamp() {
+    static __thread time_t cachedSecond = -1;
+    static __thread char buffer[32];
+
     time_t now = time(0);
-    struct tm* timeinfo = localtime(&now);
-    
-    char buffer[80];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-    
+    if (now != cachedSecond) {
+        struct tm timeinfo;
+        localtime_r(&now, &timeinfo);
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+        cachedSecond = now;
+    }
     return std::string(buffer);
 }
 
@@ -213,10 +260,9 @@ std::string Utils::formatMessage(const std::string& prefix, const std::string& c
  * @return Formatted numeric reply
  */
 std::string Utils::formatReply(int code, const std::string& target, const std::string& message) {
-    std::stringstream ss;
-    ss << std::setfill('0') << std::setw(3) << code;  // Format as 3-digit number with leading zeros
-    
-    return ss.str() + " " + target + " " + message;
+    std::string reply(5 + target.size() + message.size(), ' ');
+    writeReply(&reply[0], "", 0, code, StringRef(target.data(), target.size()), message);
+    return reply;
 }
 
 /**
@@ -228,10 +274,66 @@ std::string Utils::formatReply(int code, const std::string& target, const std::s
  * @return Formatted numeric reply with server prefix
  */
 std::string Utils::formatReply(const std::string& serverName, int code, const std::string& target, const std::string& message) {
-    std::stringstream ss;
-    ss << ":" << serverName << " " << std::setfill('0') << std::setw(3) << code << " " << target << " " << message;
-    
-    return ss.str();
+    std::string reply(2 + serverName.size() + 5 + target.size() + message.size(), ' ');
+    reply[0] = ':';
+    std::memcpy(&reply[1], serverName.data(), serverName.size());
+    writeReply(&reply[serverName.size() + 2], "", 0, code, StringRef(target.data(), target.size()), message);
+    return reply;
+}
+
+/**
+ * @brief Set the server name used as the prefix of sendReply()
+ * @param serverName The server name (e.g., "ircserv")
+ *
+ * The ":<name> " fragment is built once here instead of for every reply.
+ */
+void Utils::setServerName(const std::string& serverName) {
+    serverPrefix = ":" + serverName + " ";
+}
+
+/**
+ * @brief Send a numeric reply from the server to a client
+ * @param client Pointer to the client
+ * @param code The numeric code (e.g., 001 for welcome)
+ * @param target The target (usually the client's nickname)
+ * @param message The reply message
+ * @return true if successful, false if the client exceeded its sendq limit
+ *
+ * Same line as formatReply(serverName, ...) + "\r\n", but written straight
+ * into the client's send queue: no stream and no temporary string.
+ */
+bool Utils::sendReply(Client* client, int code, const StringRef& target, const std::string& message) {
+    if (!client) return false;
+
+    size_t length = serverPrefix.size() + 5 + target.length + message.size() + 2;
+    char* out = client->prepareOutput(length);
+    if (!out) return false;
+    out = writeReply(out, serverPrefix.data(), serverPrefix.size(), code, target, message);
+    out[0] = '\r';
+    out[1] = '\n';
+    client->commitOutput();
+    return true;
+}
+
+/**
+ * @brief Send a numeric reply whose text is a shared, already framed payload
+ * @param client Pointer to the client
+ * @param code The numeric code
+ * @param target The target (usually the client's nickname)
+ * @param body Sealed payload ending with "\r\n" (e.g. a cached NAMES chunk)
+ * @return true if successful, false if the client exceeded its sendq limit
+ *
+ * Only ":<server> <code> <target> " is written; the body is referenced.
+ */
+bool Utils::sendReply(Client* client, int code, const StringRef& target, Payload* body) {
+    if (!client || !body) return false;
+
+    size_t length = serverPrefix.size() + 5 + target.length;
+    char* out = client->prepareOutput(length);
+    if (!out) return false;
+    out = writeReply(out, serverPrefix.data(), serverPrefix.size(), code, target, std::string());
+    client->commitOutput();
+    return client->queueOutput(body);
 }
 
 /**
@@ -264,7 +366,16 @@ bool Utils::stringToInt(const std::string& str, int& result) {
  * @return String representation
  */
 std::string Utils::intToString(int value) {
-    std::stringstream ss;
-    ss << value;
-    return ss.str();
+    // Digits are produced from the end; unsigned so INT_MIN doesn't overflow
+    char buffer[16];
+    char* end = buffer + sizeof(buffer);
+    char* out = end;
+    unsigned int magnitude = value < 0 ? 0u - static_cast<unsigned int>(value) : static_cast<unsigned int>(value);
+    do {
+        *--out = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+        *--out = '-';
+    return std::string(out, end - out);
 }
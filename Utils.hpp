@@ -2,6 +2,8 @@
 #define UTILS_HPP
 
 #include "ircserv.hpp"
+#include "Payload.hpp"
+#include "StringRef.hpp"
 
 /**
  * @brief Utility functions for the IRC server
@@ -20,6 +22,7 @@ public:
     
     // Network utilities
     static bool sendToClient(Client* client, const std::string& message);
+    static bool sendToClient(Client* client, Payload* frame);
     static std::string getTimestamp();
     
     // Validation functions
@@ -31,6 +34,9 @@ public:
                                    const std::string& params);
     static std::string formatReply(int code, const std::string& target, const std::string& message);
     static std::string formatReply(const std::string& serverName, int code, const std::string& target, const std::string& message);
+    static void setServerName(const std::string& serverName);
+    static bool sendReply(Client* client, int code, const StringRef& target, const std::string& message);
+    static bool sendReply(Client* client, int code, const StringRef& target, Payload* body);
     
     // Number conversion with error checking
     static bool stringToInt(const std::string& str, int& result);
@@ -50,8 +56,13 @@ namespace IRC {
     const int RPL_CREATED = 003;
     const int RPL_MYINFO = 004;
     
+    // User mode reply
+    const int RPL_UMODEIS = 221;
+    
     // Command response codes (300-399)
+    const int RPL_NOTOPIC = 331;
     const int RPL_TOPIC = 332;
+    const int RPL_INVITING = 341;
     const int RPL_NAMREPLY = 353;
     const int RPL_ENDOFNAMES = 366;
     const int RPL_CHANNELMODEIS = 324;
@@ -60,8 +71,10 @@ namespace IRC {
     const int ERR_NOSUCHNICK = 401;
     const int ERR_NOSUCHCHANNEL = 403;
     const int ERR_CANNOTSENDTOCHAN = 404;
+    const int ERR_NOORIGIN = 409;
     const int ERR_NORECIPIENT = 411;
     const int ERR_NOTEXTTOSEND = 412;
+    const int ERR_INPUTTOOLONG = 417;
     const int ERR_UNKNOWNCOMMAND = 421;
     const int ERR_NONICKNAMEGIVEN = 431;
     const int ERR_ERRONEUSNICKNAME = 432;
@@ -74,9 +87,12 @@ namespace IRC {
     const int ERR_ALREADYREGISTERED = 462;
     const int ERR_PASSWDMISMATCH = 464;
     const int ERR_CHANNELISFULL = 471;
+    const int ERR_UNKNOWNMODE = 472;
     const int ERR_INVITEONLYCHAN = 473;
     const int ERR_BADCHANNELKEY = 475;
+    const int ERR_BADCHANMASK = 476;
     const int ERR_CHANOPRIVSNEEDED = 482;
+    const int ERR_USERSDONTMATCH = 502;
 }
 
 #endif
@@ -0,0 +1,120 @@
+/**
+ * @brief Cost per recipient of a channel broadcast
+ *
+ * Compares the old delivery path (one "message\r\n" string built and copied
+ * per member, as Utils::sendToClient(Client*, std::string) does) with the
+ * shared-payload path used by Channel::broadcast (the frame is serialized once
+ * and every send queue keeps a reference). Heap allocations are counted by
+ * replacing the global operator new.
+ *
+ * Usage: ./bench_broadcast [members] [messages]
+ */
+#include "Channel.hpp"
+#include "Client.hpp"
+#include "Utils.hpp"
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static unsigned long g_allocations = 0;
+
+// Kept out of line so the compiler does not pair free() with operator new
+__attribute__((noinline)) static void rawFree(void* p) {
+    free(p);
+}
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+    ++g_allocations;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    rawFree(p);
+}
+
+static double nowNs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec * 1e6 + tv.tv_usec) * 1000.0;
+}
+
+struct Result {
+    double ns;
+    double allocations;
+};
+
+// Write out (to /dev/null) and free everything queued for the members
+static void drain(std::vector<Client*>& members) {
+    for (size_t i = 0; i < members.size(); ++i)
+        members[i]->flushOutput();
+}
+
+static Result run(Channel& channel, std::vector<Client*>& members, int messages, bool shared) {
+    const std::string message = ":nick!user@host PRIVMSG #bench :the quick brown fox jumps over the lazy dog";
+    Result result;
+    result.ns = 0;
+    result.allocations = 0;
+
+    for (int m = 0; m < messages; ++m) {
+        unsigned long allocBefore = g_allocations;
+        double start = nowNs();
+        if (shared) {
+            channel.broadcast(message, members[0]);
+        } else {
+            for (size_t i = 1; i < members.size(); ++i)
+                Utils::sendToClient(members[i], message);
+        }
+        result.ns += nowNs() - start;
+        result.allocations += g_allocations - allocBefore;
+        drain(members);
+    }
+
+    double recipients = static_cast<double>(messages) * (members.size() - 1);
+    result.ns /= recipients;
+    result.allocations /= recipients;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 5000;
+    int messages = argc > 2 ? atoi(argv[2]) : 200;
+    if (count < 2) {
+        fprintf(stderr, "need at least 2 members\n");
+        return 1;
+    }
+
+    // Every client writes to /dev/null so flushing is cheap and harmless
+    int devnull = open("/dev/null", O_WRONLY);
+    Channel& channel = *Channel::pool().create(std::string("#bench"));
+    std::vector<Client*> members;
+    for (size_t i = 0; i < count; ++i) {
+        Client* client = Client::pool().create(devnull, std::string("127.0.0.1"));
+        client->setNickname("user" + Utils::intToString(static_cast<int>(i)));
+        channel.addClient(client);
+        members.push_back(client);
+    }
+
+    // Warm up both paths so the send queues reach their steady state
+    run(channel, members, 5, false);
+    run(channel, members, 5, true);
+
+    Result copied = run(channel, members, messages, false);
+    Result shared = run(channel, members, messages, true);
+
+    printf("members: %lu, messages: %d\n", static_cast<unsigned long>(count), messages);
+    printf("%-32s %12s %18s\n", "path", "ns/recipient", "allocs/recipient");
+    printf("%-32s %12.1f %18.4f\n", "per-recipient copy (before)", copied.ns, copied.allocations);
+    printf("%-32s %12.1f %18.4f\n", "shared payload (after)", shared.ns, shared.allocations);
+
+    for (size_t i = 0; i < members.size(); ++i)
+        Client::pool().destroy(members[i]);
+    Channel::pool().destroy(&channel);
+    close(devnull);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @brief System calls per event loop iteration under multi-channel fan-out
+ *
+ * Members join several overlapping channels; each iteration a batch of
+ * messages is sent to several of the sender's channels at once (as with
+ * "PRIVMSG #a,#b,#c :text"), then every member's queue is flushed once, as
+ * the Reactor does at the end of an iteration. writev() is replaced by a
+ * counting wrapper (the send queues of the linked modules call this one), so
+ * the report shows how many system calls the delivery took and how many
+ * lines each one carried.
+ *
+ * Usage: ./bench_fanout [members] [channels] [joins] [messages] [targets] [iterations]
+ */
+#include "Channel.hpp"
+#include "Client.hpp"
+#include "Utils.hpp"
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+
+static unsigned long g_writes = 0;
+static unsigned long g_iovecs = 0;
+
+extern "C" ssize_t writev(int fd, const struct iovec* iov, int count) {
+    ++g_writes;
+    g_iovecs += count;
+    return syscall(SYS_writev, fd, iov, count);
+}
+
+static double nowNs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec * 1e6 + tv.tv_usec) * 1000.0;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000;
+    int channelCount = argc > 2 ? atoi(argv[2]) : 20;
+    int joins = argc > 3 ? atoi(argv[3]) : 4;
+    int messages = argc > 4 ? atoi(argv[4]) : 200;
+    int targets = argc > 5 ? atoi(argv[5]) : 4;
+    int iterations = argc > 6 ? atoi(argv[6]) : 50;
+    if (count < 2 || channelCount < 1 || joins < 1 || joins > channelCount || targets < 1 || targets > joins) {
+        fprintf(stderr, "need 2 members, 1 <= targets <= joins <= channels\n");
+        return 1;
+    }
+
+    // Every client writes to /dev/null: the kernel takes everything at once
+    int devnull = open("/dev/null", O_WRONLY);
+    std::vector<Channel*> channels;
+    for (int c = 0; c < channelCount; ++c)
+        channels.push_back(Channel::pool().create("#bench" + Utils::intToString(c)));
+    std::vector<Client*> members;
+    for (size_t i = 0; i < count; ++i) {
+        Client* client = Client::pool().create(devnull, std::string("127.0.0.1"));
+        client->setNickname("user" + Utils::intToString(static_cast<int>(i)));
+        for (int j = 0; j < joins; ++j)
+            channels[(i + j) % channelCount]->addClient(client);
+        members.push_back(client);
+    }
+
+    const std::string text = " :the quick brown fox jumps over the lazy dog";
+    unsigned long deliveries = 0;
+    unsigned long flushed = 0;
+    g_writes = 0;
+    g_iovecs = 0;
+    double start = nowNs();
+    for (int it = 0; it < iterations; ++it) {
+        for (int m = 0; m < messages; ++m) {
+            size_t sender = (static_cast<size_t>(it) * messages + m) * 7919 % count;
+            for (int t = 0; t < targets; ++t) {
+                Channel* channel = channels[(sender + t) % channelCount];
+                channel->broadcast(":user!bench@127.0.0.1 PRIVMSG " + channel->getName() + text, members[sender]);
+                deliveries += channel->getClientCount() - 1;
+            }
+        }
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (members[i]->getSendqSize() > 0)
+                ++flushed;
+            members[i]->flushOutput();
+        }
+    }
+    double elapsed = nowNs() - start;
+
+    printf("members: %lu, channels: %d, joins: %d, messages per iteration: %d to %d channels, iterations: %d\n",
+           static_cast<unsigned long>(count), channelCount, joins, messages, targets, iterations);
+    printf("%-28s %12lu\n", "deliveries", deliveries);
+    printf("%-28s %12lu\n", "writev calls", g_writes);
+    printf("%-28s %12.2f\n", "writev per flushed client", static_cast<double>(g_writes) / flushed);
+    printf("%-28s %12.1f\n", "lines per writev", static_cast<double>(deliveries) / g_writes);
+    printf("%-28s %12.1f\n", "iovecs per writev", static_cast<double>(g_iovecs) / g_writes);
+    printf("%-28s %12.1f\n", "ns per delivery", elapsed / deliveries);
+
+    for (size_t i = 0; i < members.size(); ++i)
+        Client::pool().destroy(members[i]);
+    for (size_t c = 0; c < channels.size(); ++c)
+        Channel::pool().destroy(channels[c]);
+    close(devnull);
+    return 0;
+}
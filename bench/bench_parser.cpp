@@ -0,0 +1,64 @@
+/**
+ * @brief Parser throughput in lines per second
+ *
+ * Parses a mix of typical client and server lines with Parser::parse and,
+ * for comparison, tokenizes the same lines with Utils::split (stringstream +
+ * one std::string per token), which was the only tokenizer before.
+ *
+ * Usage: ./bench_parser [lines]
+ */
+#include "Parser.hpp"
+#include "Utils.hpp"
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+
+static double nowSec() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static const char* const SAMPLES[] = {
+    "PRIVMSG #general :hello everyone, how is it going today?",
+    ":alice!alice@127.0.0.1 PRIVMSG #general :fine thanks",
+    "JOIN #general,#random key1",
+    "NICK bob",
+    "USER bob 0 * :Bob the Builder",
+    "PING :irc.example.net",
+    "MODE #general +kl secret 50",
+    "KICK #general carol :spamming",
+    ":irc.example.net 353 bob = #general :@alice bob carol dave",
+    "TOPIC #general :Welcome to the general channel"
+};
+
+int main(int argc, char* argv[]) {
+    long lines = argc > 1 ? atol(argv[1]) : 5000000;
+    const size_t sampleCount = sizeof(SAMPLES) / sizeof(SAMPLES[0]);
+    std::vector<std::string> samples(SAMPLES, SAMPLES + sampleCount);
+
+    // Parser::parse: tokens are offsets into the line, no allocation
+    size_t checksum = 0;
+    double start = nowSec();
+    for (long i = 0; i < lines; ++i) {
+        const std::string& line = samples[i % sampleCount];
+        Message message;
+        if (Parser::parse(line.data(), line.size(), message) == Parser::PARSE_OK)
+            checksum += message.paramCount + message.command.length;
+    }
+    double parserTime = nowSec() - start;
+
+    // Utils::split: one std::string per token
+    long splitLines = lines / 10;
+    start = nowSec();
+    for (long i = 0; i < splitLines; ++i) {
+        std::vector<std::string> tokens = Utils::split(samples[i % sampleCount], ' ');
+        checksum += tokens.size();
+    }
+    double splitTime = nowSec() - start;
+
+    printf("%-16s %14s %12s\n", "tokenizer", "lines/s", "ns/line");
+    printf("%-16s %14.0f %12.1f\n", "Parser::parse", lines / parserTime, parserTime * 1e9 / lines);
+    printf("%-16s %14.0f %12.1f\n", "Utils::split", splitLines / splitTime, splitTime * 1e9 / splitLines);
+    return checksum == 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @brief Wakeup cost of the event loop backends versus connection count
+ *
+ * For each connection count N we create N socket pairs, register one end of
+ * each pair with the poller, then repeatedly make a single random socket
+ * readable and measure how long it takes the poller to report it. With poll()
+ * the cost grows with N (the whole array is scanned); with epoll it stays flat.
+ *
+ * Usage: ./bench_poller [iterations]
+ */
+#include "Poller.hpp"
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static double nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+// Raise the fd limit as far as allowed and return how many pairs fit
+static size_t maxPairs() {
+    struct rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    getrlimit(RLIMIT_NOFILE, &rl);
+    return (rl.rlim_cur - 16) / 2;
+}
+
+static double measure(Poller::Backend backend, size_t connections, int iterations) {
+    std::vector<int> readers(connections);
+    std::vector<int> writers(connections);
+    Poller* poller = Poller::create(backend);
+
+    for (size_t i = 0; i < connections; ++i) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == -1) {
+            perror("socketpair");
+            exit(1);
+        }
+        readers[i] = sv[0];
+        writers[i] = sv[1];
+        poller->add(sv[0], &readers[i], Poller::EV_READ);
+    }
+
+    std::vector<Poller::Event> events(64);
+    srand(42);
+    double start = nowUs();
+    for (int it = 0; it < iterations; ++it) {
+        size_t target = rand() % connections;
+        char byte = 'x';
+        if (write(writers[target], &byte, 1) != 1) {
+            perror("write");
+            exit(1);
+        }
+        int count = poller->wait(&events[0], events.size(), -1);
+        for (int e = 0; e < count; ++e) {
+            int fd = *static_cast<int*>(events[e].data);
+            while (read(fd, &byte, 1) == 1) {
+            }
+        }
+    }
+    double elapsed = nowUs() - start;
+
+    delete poller;
+    for (size_t i = 0; i < connections; ++i) {
+        close(readers[i]);
+        close(writers[i]);
+    }
+    return elapsed * 1000.0 / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    static const size_t counts[] = { 10, 100, 1000, 5000, 10000, 20000 };
+    size_t limit = maxPairs();
+
+    printf("%12s %16s %16s\n", "connections", "poll ns/wakeup", "epoll ns/wakeup");
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+        if (counts[i] > limit) {
+            printf("%12lu %16s %16s  (fd limit reached)\n",
+                   static_cast<unsigned long>(counts[i]), "-", "-");
+            continue;
+        }
+        double pollCost = measure(Poller::BACKEND_POLL, counts[i], iterations);
+        double epollCost = measure(Poller::BACKEND_EPOLL, counts[i], iterations);
+        printf("%12lu %16.0f %16.0f\n", static_cast<unsigned long>(counts[i]), pollCost, epollCost);
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @brief Nickname registry cost at 100k registered nicks
+ *
+ * Registers N nicknames, then measures lookups (in a different case than
+ * registered), misses, nick changes and removals, with Registry and, for
+ * comparison, a std::map keyed by Utils::toLower(), which allocates a folded
+ * copy of the name for every operation.
+ *
+ * Usage: ./bench_registry [nicks]
+ */
+#include "Registry.hpp"
+#include "Utils.hpp"
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+static double nowSec() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Some name that looks like a nickname, with RFC 1459 special characters
+static std::string makeNick(long i, bool upper) {
+    static const char* const STEMS[] = {"alice", "Bob[away]", "carol", "dave^", "eve\\x"};
+    std::string nick = STEMS[i % 5] + Utils::intToString(static_cast<int>(i));
+    return upper ? Utils::toUpper(nick) : nick;
+}
+
+static void printRow(const char* name, double seconds, long ops) {
+    printf("%-26s %12.1f\n", name, seconds * 1e9 / ops);
+}
+
+int main(int argc, char* argv[]) {
+    long count = argc > 1 ? atol(argv[1]) : 100000;
+    std::vector<std::string> nicks, shouted, renamed, missing;
+    for (long i = 0; i < count; ++i) {
+        nicks.push_back(makeNick(i, false));
+        shouted.push_back(makeNick(i, true));
+        renamed.push_back(makeNick(i + count, false));
+        missing.push_back(makeNick(i + 2 * count, true));
+    }
+    Client* const dummy = reinterpret_cast<Client*>(16);
+    size_t found = 0;
+
+    printf("%ld nicknames\n%-26s %12s\n", count, "operation", "ns/op");
+
+    Registry<Client> registry;
+    double start = nowSec();
+    for (long i = 0; i < count; ++i)
+        registry.insert(nicks[i], dummy);
+    printRow("Registry insert", nowSec() - start, count);
+    start = nowSec();
+    for (long i = 0; i < count; ++i)
+        found += registry.find(shouted[i]) != NULL;
+    printRow("Registry find (hit)", nowSec() - start, count);
+    start = nowSec();
+    for (long i = 0; i < count; ++i)
+        found += registry.find(missing[i]) != NULL;
+    printRow("Registry find (miss)", nowSec() - start, count);
+    start = nowSec();
+    for (long i = 0; i < count; ++i)
+        registry.rename(nicks[i], renamed[i]);
+    printRow("Registry rename", nowSec() - start, count);
+    start = nowSec();
+    for (long i = 0; i < count; ++i)
+        registry.remove(renamed[i]);
+    printRow("Registry remove", nowSec() - start, count);
+
+    std::map<std::string, Client*> map;
+    start = nowSec();
+    for (long i = 0; i < count; ++i)
+        map[Utils::toLower(nicks[i])] = dummy;
+    printRow("std::map insert", nowSec() - start, count);
+    start = nowSec();
+    for (long i = 0; i < count; ++i)
+        found += map.find(Utils::toLower(shouted[i])) != map.end();
+    printRow("std::map find (hit)", nowSec() - start, count);
+    start = nowSec();
+    for (long i = 0; i < count; ++i)
+        found += map.find(Utils::toLower(missing[i])) != map.end();
+    printRow("std::map find (miss)", nowSec() - start, count);
+    start = nowSec();
+    for (long i = 0; i < count; ++i) {
+        map.erase(Utils::toLower(nicks[i]));
+        map[Utils::toLower(renamed[i])] = dummy;
+    }
+    printRow("std::map rename", nowSec() - start, count);
+    start = nowSec();
+    for (long i = 0; i < count; ++i)
+        map.erase(Utils::toLower(renamed[i]));
+    printRow("std::map remove", nowSec() - start, count);
+
+    return found != static_cast<size_t>(2 * count);
+}
@@ -0,0 +1,142 @@
+/**
+ * @brief Cost of formatting and queueing a numeric reply
+ *
+ * Sends the connect burst (001-004 plus the JOIN numerics) to a client
+ * through three paths:
+ * - the old Utils::formatReply (std::stringstream with setfill/setw, copied
+ *   here since it was replaced) followed by Utils::sendToClient,
+ * - the current Utils::formatReply followed by Utils::sendToClient,
+ * - Utils::sendReply, which writes the line straight into the send queue.
+ * Heap allocations are counted by replacing the global operator new.
+ *
+ * Usage: ./bench_reply [bursts]
+ */
+#include "Client.hpp"
+#include "Utils.hpp"
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+static unsigned long g_allocations = 0;
+
+// Kept out of line so the compiler does not pair free() with operator new
+__attribute__((noinline)) static void rawFree(void* p) {
+    free(p);
+}
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+    ++g_allocations;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    rawFree(p);
+}
+
+static double nowNs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec * 1e6 + tv.tv_usec) * 1000.0;
+}
+
+// Utils::formatReply before the code table
+static std::string legacyFormatReply(const std::string& serverName, int code, const std::string& target,
+                                     const std::string& message) {
+    std::stringstream ss;
+    ss << ":" << serverName << " " << std::setfill('0') << std::setw(3) << code << " " << target << " " << message;
+    return ss.str();
+}
+
+struct Reply {
+    int code;
+    std::string message;
+};
+
+enum Path { PATH_LEGACY, PATH_FORMAT, PATH_SEND };
+
+struct Result {
+    double ns;
+    double allocations;
+};
+
+static Result run(Client* client, const std::vector<Reply>& burst, int bursts, Path path) {
+    const std::string server = "ircserv";
+    const std::string nick = client->getNickname().str();
+    Result result;
+    result.ns = 0;
+    result.allocations = 0;
+
+    for (int b = 0; b < bursts; ++b) {
+        unsigned long allocBefore = g_allocations;
+        double start = nowNs();
+        for (size_t i = 0; i < burst.size(); ++i) {
+            const Reply& reply = burst[i];
+            if (path == PATH_LEGACY)
+                Utils::sendToClient(client, legacyFormatReply(server, reply.code, nick, reply.message));
+            else if (path == PATH_FORMAT)
+                Utils::sendToClient(client, Utils::formatReply(server, reply.code, nick, reply.message));
+            else
+                Utils::sendReply(client, reply.code, StringRef(nick.data(), nick.size()), reply.message);
+        }
+        result.ns += nowNs() - start;
+        result.allocations += g_allocations - allocBefore;
+        // Write out to /dev/null so the queue stays small
+        client->flushOutput();
+    }
+
+    double replies = static_cast<double>(bursts) * burst.size();
+    result.ns /= replies;
+    result.allocations /= replies;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    int bursts = argc > 1 ? atoi(argv[1]) : 200000;
+
+    int devnull = open("/dev/null", O_WRONLY);
+    Client* client = Client::pool().create(devnull, std::string("127.0.0.1"));
+    client->setNickname("alice");
+    client->setUsername("alice");
+    Utils::setServerName("ircserv");
+
+    // What a client receives when it registers and joins a channel
+    std::vector<Reply> burst;
+    Reply r;
+    r.code = IRC::RPL_WELCOME;    r.message = ":Welcome to the Internet Relay Network " + client->getPrefix(); burst.push_back(r);
+    r.code = IRC::RPL_YOURHOST;   r.message = ":Your host is ircserv, running version 1.0"; burst.push_back(r);
+    r.code = IRC::RPL_CREATED;    r.message = ":This server was created 2025-06-01 12:00:00"; burst.push_back(r);
+    r.code = IRC::RPL_MYINFO;     r.message = "ircserv 1.0 o itkolv"; burst.push_back(r);
+    r.code = IRC::RPL_TOPIC;      r.message = "#general :Welcome to the general channel"; burst.push_back(r);
+    r.code = IRC::RPL_NAMREPLY;   r.message = "= #general :@alice bob carol dave"; burst.push_back(r);
+    r.code = IRC::RPL_ENDOFNAMES; r.message = "#general :End of /NAMES list"; burst.push_back(r);
+
+    // The new formatter must produce the same bytes as the old one
+    if (Utils::formatReply("ircserv", 1, "alice", "x") != legacyFormatReply("ircserv", 1, "alice", "x")) {
+        fprintf(stderr, "formatReply output differs\n");
+        return 1;
+    }
+
+    run(client, burst, bursts / 10, PATH_LEGACY);
+    run(client, burst, bursts / 10, PATH_SEND);
+
+    Result legacy = run(client, burst, bursts, PATH_LEGACY);
+    Result format = run(client, burst, bursts, PATH_FORMAT);
+    Result send = run(client, burst, bursts, PATH_SEND);
+
+    printf("replies: %lu\n", static_cast<unsigned long>(bursts) * burst.size());
+    printf("%-40s %10s %14s\n", "path", "ns/reply", "allocs/reply");
+    printf("%-40s %10.1f %14.2f\n", "stringstream formatReply (before)", legacy.ns, legacy.allocations);
+    printf("%-40s %10.1f %14.2f\n", "formatReply + sendToClient", format.ns, format.allocations);
+    printf("%-40s %10.1f %14.2f\n", "sendReply (into the send queue)", send.ns, send.allocations);
+
+    Client::pool().destroy(client);
+    close(devnull);
+    return 0;
+}
@@ -0,0 +1,708 @@
+/**
+ * @brief Load generator and end-to-end latency benchmark for ircserv
+ *
+ * Opens many connections to a running server on loopback, registers them
+ * (PASS/NICK/USER), joins them to a set of channels and then sends PRIVMSGs
+ * to those channels at a fixed total rate. Every message carries the time it
+ * was sent, so each delivery to another member gives one end-to-end latency
+ * sample (client write -> server -> client read). The samples go into a
+ * log-linear histogram (about 1.5% resolution) for the percentiles.
+ *
+ * Topology: client i joins --joins channels, starting at channel i modulo
+ * --channels, so every channel gets about clients * joins / channels members.
+ * A sender picks one of its channels per message, round-robin.
+ *
+ * The generator is single-threaded. If its own loop can't keep up the report
+ * shows fewer messages sent than requested; lower --rate or run several.
+ *
+ * Set-up is timed too: --in-flight bounds the handshakes started but not yet
+ * registered. Raising it to --clients connects everyone at once, like clients
+ * reconnecting after a server restart; with --duration=0 only that storm is
+ * measured (time until every client is registered, and per-client
+ * connect-to-001 latency).
+ *
+ * Fairness: --abusers adds connections that join a channel of their own and
+ * send PRIVMSGs to it as fast as the server takes them. Their messages reach
+ * nobody, so the latency of the other clients only suffers if the server
+ * spends its time on the flood instead of on them. With flood control off
+ * they stand for bulk senders (bots, pastes): the read budget should give them
+ * the server's spare throughput without hurting the others' latency.
+ *
+ * System calls: with --admin (the server's admin port) the server's
+ * ircserv_io_syscalls_total is read from /metrics when recording starts and
+ * ends, and reported per message and per delivery, to compare backends
+ * (epoll makes one call per read and write, io_uring batches them). The
+ * server's resident memory (process_resident_memory_bytes) is read as well,
+ * before the first connection and once every client is set up, to report
+ * what an idle connection costs.
+ *
+ * Usage: ./ircbench [--host=127.0.0.1] [--port=6667] [--password=bench]
+ *                   [--clients=1000] [--channels=10] [--joins=1] [--rate=10000]
+ *                   [--size=64] [--warmup=2] [--duration=10] [--in-flight=64]
+ *                   [--abusers=0] [--backend=epoll|poll] [--admin=port]
+ */
+#include "Poller.hpp"
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef unsigned long long Nanos;
+
+static Nanos nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<Nanos>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Log-linear latency histogram
+ *
+ * Values below 128 ns have their own bucket; above that, every power of two
+ * is split into 64 buckets, so a bucket is at most 1/64 of its value wide.
+ */
+class Histogram {
+private:
+    static const int SUB_BITS = 6;
+    static const int EXACT = 2 << SUB_BITS;         // 128
+    std::vector<unsigned long> _counts;
+    unsigned long _total;
+    Nanos _max;
+
+    static int msb(Nanos value) {
+        return 63 - __builtin_clzll(value);
+    }
+
+    static size_t bucketOf(Nanos value) {
+        if (value < static_cast<Nanos>(EXACT))
+            return static_cast<size_t>(value);
+        int shift = msb(value) - SUB_BITS;
+        return EXACT + (shift - 1) * (1 << SUB_BITS) + static_cast<size_t>((value >> shift) - (1 << SUB_BITS));
+    }
+
+    // Highest value that falls into a bucket
+    static Nanos upperBound(size_t bucket) {
+        if (bucket < static_cast<size_t>(EXACT))
+            return bucket;
+        size_t shift = (bucket - EXACT) / (1 << SUB_BITS) + 1;
+        Nanos sub = (bucket - EXACT) % (1 << SUB_BITS) + (1 << SUB_BITS);
+        return ((sub + 1) << shift) - 1;
+    }
+
+public:
+    Histogram() : _counts(EXACT + 58 * (1 << SUB_BITS), 0), _total(0), _max(0) {}
+
+    void record(Nanos value) {
+        ++_counts[bucketOf(value)];
+        ++_total;
+        if (value > _max)
+            _max = value;
+    }
+
+    unsigned long total() const {
+        return _total;
+    }
+
+    Nanos max() const {
+        return _max;
+    }
+
+    // Smallest value with at least `quantile` of the samples at or below it
+    Nanos percentile(double quantile) const {
+        if (_total == 0)
+            return 0;
+        unsigned long rank = static_cast<unsigned long>(quantile * _total);
+        if (rank == 0)
+            rank = 1;
+        unsigned long seen = 0;
+        for (size_t i = 0; i < _counts.size(); ++i) {
+            seen += _counts[i];
+            if (seen >= rank)
+                return upperBound(i) < _max ? upperBound(i) : _max;
+        }
+        return _max;
+    }
+};
+
+struct Options {
+    std::string host;
+    int port;
+    std::string password;
+    int clients;
+    int channels;
+    int joins;
+    double rate;            // Messages per second, all senders together
+    int size;               // Bytes of text per message
+    double warmup;          // Seconds of traffic before samples are recorded
+    double duration;        // Seconds of recorded traffic; 0 only measures set-up
+    int inFlight;           // Handshakes in progress at once during set-up
+    int abusers;            // Extra connections flooding as fast as they can
+    int admin;              // Server admin port to read its metrics from, 0 for none
+    Poller::Backend backend;
+
+    Options() : host("127.0.0.1"), port(6667), password("bench"), clients(1000), channels(10),
+                joins(1), rate(10000), size(64), warmup(2), duration(10), inFlight(64), abusers(0), admin(0),
+                backend(Poller::BACKEND_EPOLL) {}
+};
+
+enum State {
+    STATE_CONNECTING,       // Non-blocking connect() in progress
+    STATE_REGISTERING,      // PASS/NICK/USER sent, waiting for 001
+    STATE_JOINING,          // JOIN sent, waiting for one 366 per channel
+    STATE_READY,
+    STATE_CLOSED
+};
+
+struct Connection {
+    int fd;
+    int id;
+    State state;
+    std::vector<int> channels;  // Channel numbers joined
+    int joinsPending;
+    Nanos startedAt;            // connect() call
+    size_t nextChannel;         // Round-robin position in channels
+    std::string in;             // Received bytes not yet split into lines
+    std::string out;            // Bytes waiting for the socket to accept them
+    bool writeArmed;
+    bool abuser;                // Floods its own channel instead of following the rate
+};
+
+struct Stats {
+    int connected;
+    int registered;
+    int ready;
+    int closed;
+    int errors;
+    unsigned long sent;             // Messages sent while recording
+    unsigned long expected;         // Deliveries those messages should cause
+    unsigned long received;         // Deliveries of recorded messages
+    unsigned long flooded;          // Bytes of abuser messages the server took while recording
+    double syscalls;                // Server system calls while recording, -1 if unknown
+    double rssBefore;               // Server resident memory before set-up, -1 if unknown
+    double rssReady;                // ... and once every client is ready
+    Histogram latency;
+    Histogram registration;         // connect() to 001, per client
+    Nanos allRegistered;            // Set-up start to the last 001
+    Nanos allReady;                 // Set-up start to the last 366
+
+    Stats() : connected(0), registered(0), ready(0), closed(0), errors(0), sent(0), expected(0), received(0),
+              flooded(0), syscalls(-1), rssBefore(-1), rssReady(-1), allRegistered(0), allReady(0) {}
+};
+
+class Bench {
+private:
+    Options _options;
+    Poller* _poller;
+    std::vector<Connection> _connections;
+    std::vector<int> _members;      // Members per channel
+    std::vector<Poller::Event> _events;
+    Stats _stats;
+    Nanos _recordFrom;              // Messages sent in [_recordFrom, _recordUntil) are sampled
+    Nanos _recordUntil;
+    Nanos _setUpStart;
+    std::string _padding;
+    std::string _flood;             // A batch of abuser messages
+
+public:
+    Bench(const Options& options)
+        : _options(options), _poller(Poller::create(options.backend)), _members(options.channels, 0),
+          _events(1024), _recordFrom(~0ULL), _recordUntil(~0ULL), _setUpStart(0), _padding(options.size, 'x') {
+        std::string line = "PRIVMSG #flood :" + _padding + "\r\n";
+        for (int i = 0; i < 64; ++i)
+            _flood += line;
+    }
+
+    ~Bench() {
+        for (size_t i = 0; i < _connections.size(); ++i) {
+            if (_connections[i].state != STATE_CLOSED)
+                close(_connections[i].fd);
+        }
+        delete _poller;
+    }
+
+    bool setUp();
+    void run();
+    void report() const;
+
+private:
+    bool connect(Connection& connection);
+    void poll(int timeoutMs);
+    void handleEvent(Connection& connection, unsigned int events);
+    void readInput(Connection& connection);
+    void handleLine(Connection& connection, const std::string& line);
+    void send(Connection& connection, const std::string& data);
+    void flush(Connection& connection);
+    void drop(Connection& connection, bool error);
+    void sendMessage(Connection& connection);
+    void sendFlood(Connection& connection);
+};
+
+// Start a non-blocking connect; completion is reported as writability
+bool Bench::connect(Connection& connection) {
+    connection.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connection.fd == -1) {
+        perror("socket");
+        return false;
+    }
+    fcntl(connection.fd, F_SETFL, O_NONBLOCK);
+    int one = 1;
+    setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(_options.port);
+    inet_pton(AF_INET, _options.host.c_str(), &address.sin_addr);
+    if (::connect(connection.fd, (struct sockaddr*)&address, sizeof(address)) == -1 && errno != EINPROGRESS) {
+        perror("connect");
+        close(connection.fd);
+        return false;
+    }
+    connection.state = STATE_CONNECTING;
+    connection.startedAt = nowNs();
+    connection.writeArmed = true;
+    _poller->add(connection.fd, &connection, Poller::EV_READ | Poller::EV_WRITE);
+    return true;
+}
+
+// Queue bytes for a connection, writing right away when the socket allows
+void Bench::send(Connection& connection, const std::string& data) {
+    if (connection.state == STATE_CLOSED)
+        return;
+    connection.out += data;
+    if (!connection.writeArmed)
+        flush(connection);
+}
+
+void Bench::flush(Connection& connection) {
+    while (!connection.out.empty()) {
+        ssize_t written = ::send(connection.fd, connection.out.data(), connection.out.size(), MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (written <= 0) {
+            drop(connection, true);
+            return;
+        }
+        connection.out.erase(0, written);
+        if (connection.abuser) {
+            Nanos now = nowNs();
+            if (now >= _recordFrom && now < _recordUntil)
+                _stats.flooded += written;
+        }
+    }
+    bool wantWrite = !connection.out.empty();
+    if (wantWrite != connection.writeArmed) {
+        connection.writeArmed = wantWrite;
+        _poller->modify(connection.fd, &connection, Poller::EV_READ | (wantWrite ? Poller::EV_WRITE : 0));
+    }
+}
+
+void Bench::drop(Connection& connection, bool error) {
+    if (connection.state == STATE_CLOSED)
+        return;
+    if (connection.state == STATE_READY)
+        --_stats.ready;
+    _poller->remove(connection.fd);
+    close(connection.fd);
+    connection.state = STATE_CLOSED;
+    ++_stats.closed;
+    if (error)
+        ++_stats.errors;
+}
+
+void Bench::handleEvent(Connection& connection, unsigned int events) {
+    if (connection.state == STATE_CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            fprintf(stderr, "connect: %s\n", strerror(error));
+            drop(connection, true);
+            return;
+        }
+        ++_stats.connected;
+        connection.state = STATE_REGISTERING;
+        connection.writeArmed = false;
+        _poller->modify(connection.fd, &connection, Poller::EV_READ);
+
+        char nick[32];
+        snprintf(nick, sizeof(nick), "bench%d", connection.id);
+        send(connection, "PASS " + _options.password + "\r\nNICK " + nick + "\r\nUSER bench 0 * :ircbench\r\n");
+        return;
+    }
+    if (events & Poller::EV_WRITE)
+        flush(connection);
+    if (connection.state != STATE_CLOSED && (events & (Poller::EV_READ | Poller::EV_HANGUP | Poller::EV_ERROR)))
+        readInput(connection);
+}
+
+void Bench::readInput(Connection& connection) {
+    char buffer[16384];
+    while (connection.state != STATE_CLOSED) {
+        ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (received <= 0) {
+            drop(connection, true);
+            return;
+        }
+        connection.in.append(buffer, received);
+
+        size_t start = 0;
+        size_t end;
+        while ((end = connection.in.find("\r\n", start)) != std::string::npos) {
+            handleLine(connection, connection.in.substr(start, end - start));
+            start = end + 2;
+        }
+        connection.in.erase(0, start);
+        if (!_poller->isEdgeTriggered())
+            break;
+    }
+}
+
+void Bench::handleLine(Connection& connection, const std::string& line) {
+    Nanos now = nowNs();
+    if (line.compare(0, 5, "PING ") == 0) {
+        send(connection, "PONG " + line.substr(5) + "\r\n");
+        return;
+    }
+
+    // ":prefix COMMAND params"
+    size_t space = line.find(' ');
+    if (line.empty() || line[0] != ':' || space == std::string::npos)
+        return;
+    size_t commandEnd = line.find(' ', space + 1);
+    std::string command = line.substr(space + 1, commandEnd == std::string::npos ? std::string::npos : commandEnd - space - 1);
+
+    if (command == "PRIVMSG") {
+        // The text starts with the send time in nanoseconds
+        size_t text = line.find(" :", commandEnd);
+        if (text == std::string::npos)
+            return;
+        Nanos sentAt = strtoull(line.c_str() + text + 2, NULL, 10);
+        if (sentAt >= _recordFrom && sentAt < _recordUntil) {
+            ++_stats.received;
+            _stats.latency.record(now > sentAt ? now - sentAt : 0);
+        }
+    } else if (command == "001" && connection.state == STATE_REGISTERING) {
+        _stats.registration.record(now - connection.startedAt);
+        if (++_stats.registered == static_cast<int>(_connections.size()))
+            _stats.allRegistered = now - _setUpStart;
+        connection.state = STATE_JOINING;
+        if (connection.abuser) {
+            connection.joinsPending = 1;
+            send(connection, "JOIN #flood\r\n");
+            return;
+        }
+        std::string join = "JOIN ";
+        for (size_t i = 0; i < connection.channels.size(); ++i) {
+            char name[32];
+            snprintf(name, sizeof(name), "%s#bench%d", i ? "," : "", connection.channels[i]);
+            join += name;
+        }
+        connection.joinsPending = connection.channels.size();
+        send(connection, join + "\r\n");
+    } else if (command == "366" && connection.state == STATE_JOINING) {
+        if (--connection.joinsPending == 0) {
+            connection.state = STATE_READY;
+            if (++_stats.ready == static_cast<int>(_connections.size()))
+                _stats.allReady = now - _setUpStart;
+        }
+    } else if (command.size() == 3 && (command[0] == '4' || command[0] == '5')) {
+        fprintf(stderr, "client %d: %s\n", connection.id, line.c_str());
+        if (connection.state != STATE_READY)
+            drop(connection, true);
+    }
+}
+
+// Send one timestamped PRIVMSG to the next of the connection's channels
+void Bench::sendMessage(Connection& connection) {
+    int channel = connection.channels[connection.nextChannel];
+    connection.nextChannel = (connection.nextChannel + 1) % connection.channels.size();
+
+    Nanos now = nowNs();
+    char head[64];
+    snprintf(head, sizeof(head), "PRIVMSG #bench%d :%llu ", channel, now);
+    send(connection, head + _padding + "\r\n");
+    if (now >= _recordFrom && now < _recordUntil) {
+        ++_stats.sent;
+        _stats.expected += _members[channel] - 1;
+    }
+}
+
+// Keep an abuser's socket full: top its buffer up whenever the server took it
+void Bench::sendFlood(Connection& connection) {
+    if (connection.state == STATE_READY && !connection.writeArmed)
+        send(connection, _flood);
+}
+
+void Bench::poll(int timeoutMs) {
+    int count = _poller->wait(&_events[0], _events.size(), timeoutMs);
+    for (int i = 0; i < count; ++i)
+        handleEvent(*static_cast<Connection*>(_events[i].data), _events[i].events);
+}
+
+// Sum of a metric's samples (one per event loop, or a single one), from the
+// server's admin port (a blocking HTTP request). Returns -1 if it can't be read.
+static double scrapeMetric(const Options& options, const std::string& name) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.admin);
+    address.sin_addr.s_addr = inet_addr(options.host.c_str());
+    const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+    std::string response;
+    if (fd != -1 && connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0 &&
+        write(fd, request, sizeof(request) - 1) == static_cast<ssize_t>(sizeof(request) - 1)) {
+        char buffer[16384];
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+            response.append(buffer, length);
+    }
+    if (fd != -1)
+        close(fd);
+
+    // name{reactor="0"} value, or name value
+    double total = -1;
+    for (size_t at = response.find("\n" + name); at != std::string::npos; at = response.find("\n" + name, at + 1)) {
+        const char* sample = response.c_str() + at + 1 + name.size();
+        if (*sample == '{') {
+            const char* labels = strchr(sample, '}');
+            sample = labels ? labels + 1 : "";
+        }
+        if (*sample == ' ')
+            total = (total < 0 ? 0 : total) + strtod(sample + 1, NULL);
+    }
+    return total;
+}
+
+// Connect, register and join every client
+bool Bench::setUp() {
+    struct rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    int total = _options.clients + _options.abusers;
+    if (static_cast<rlim_t>(total) + 16 > rl.rlim_cur) {
+        fprintf(stderr, "too many clients for the file descriptor limit (%lu)\n", static_cast<unsigned long>(rl.rlim_cur));
+        return false;
+    }
+
+    // Connection objects must not move: the poller keeps pointers to them.
+    // Abusers come last.
+    _connections.resize(total);
+    for (int i = 0; i < total; ++i) {
+        Connection& connection = _connections[i];
+        connection.id = i;
+        connection.state = STATE_CLOSED;
+        connection.joinsPending = 0;
+        connection.nextChannel = 0;
+        connection.writeArmed = false;
+        connection.abuser = (i >= _options.clients);
+        for (int j = 0; !connection.abuser && j < _options.joins && j < _options.channels; ++j) {
+            int channel = (i + j) % _options.channels;
+            connection.channels.push_back(channel);
+            ++_members[channel];
+        }
+    }
+
+    if (_options.admin > 0)
+        _stats.rssBefore = scrapeMetric(_options, "process_resident_memory_bytes");
+
+    // Keep a bounded number of handshakes in flight (by default few enough
+    // that a small listen backlog doesn't turn into SYN retransmissions)
+    _setUpStart = nowNs();
+    Nanos deadline = _setUpStart + 120ULL * 1000000000ULL;
+    int started = 0;
+    while (_stats.ready < total && nowNs() < deadline) {
+        while (started < total && started - _stats.ready - _stats.closed < _options.inFlight) {
+            if (!connect(_connections[started]))
+                return false;
+            ++started;
+        }
+        if (_stats.errors > 0)
+            return false;
+        poll(10);
+    }
+    if (_stats.ready < total) {
+        fprintf(stderr, "only %d of %d clients ready\n", _stats.ready, total);
+        return false;
+    }
+    if (_options.admin > 0)
+        _stats.rssReady = scrapeMetric(_options, "process_resident_memory_bytes");
+    return true;
+}
+
+// Send at the target rate, then wait for the last deliveries
+void Bench::run() {
+    Nanos start = nowNs();
+    _recordFrom = start + static_cast<Nanos>(_options.warmup * 1e9);
+    _recordUntil = _recordFrom + static_cast<Nanos>(_options.duration * 1e9);
+    unsigned long total = 0;
+    size_t sender = 0;
+    double syscallsBefore = -1;
+    bool recording = false;
+
+    while (true) {
+        Nanos now = nowNs();
+        if (!recording && now >= _recordFrom) {
+            recording = true;
+            if (_options.admin > 0)
+                syscallsBefore = scrapeMetric(_options, "ircserv_io_syscalls_total");
+        }
+        if (now >= _recordUntil)
+            break;
+        // Catch up with the schedule, a bounded burst at a time
+        unsigned long due = static_cast<unsigned long>((now - start) / 1e9 * _options.rate);
+        for (int burst = 0; total < due && burst < 1000; ++burst, ++total) {
+            for (size_t tries = 0; tries < _connections.size(); ++tries) {
+                Connection& connection = _connections[sender];
+                sender = (sender + 1) % _connections.size();
+                if (connection.state == STATE_READY && !connection.abuser) {
+                    sendMessage(connection);
+                    break;
+                }
+            }
+        }
+        for (size_t i = _options.clients; i < _connections.size(); ++i)
+            sendFlood(_connections[i]);
+        poll(total < due ? 0 : 1);
+    }
+    if (syscallsBefore >= 0) {
+        double syscallsAfter = scrapeMetric(_options, "ircserv_io_syscalls_total");
+        if (syscallsAfter >= syscallsBefore)
+            _stats.syscalls = syscallsAfter - syscallsBefore;
+    }
+
+    // Late deliveries still count; give them a few seconds
+    Nanos drainUntil = nowNs() + 3ULL * 1000000000ULL;
+    while (_stats.received < _stats.expected && nowNs() < drainUntil)
+        poll(10);
+}
+
+void Bench::report() const {
+    const Stats& s = _stats;
+    printf("clients: %d, channels: %d, joins per client: %d, message: %d bytes\n",
+           _options.clients, _options.channels, _options.joins, _options.size);
+    printf("set-up with %d handshakes in flight: all registered in %.1f ms, all joined in %.1f ms\n",
+           _options.inFlight, s.allRegistered / 1e6, s.allReady / 1e6);
+    printf("%-24s %8s %8s %8s %8s\n", "connect to 001 (ms)", "p50", "p99", "p999", "max");
+    printf("%-24s %8.1f %8.1f %8.1f %8.1f\n", "",
+           s.registration.percentile(0.50) / 1e6, s.registration.percentile(0.99) / 1e6,
+           s.registration.percentile(0.999) / 1e6, s.registration.max() / 1e6);
+    if (s.rssBefore >= 0 && s.rssReady >= 0) {
+        int clients = _options.clients + _options.abusers;
+        printf("server memory: %.1f MB before set-up, %.1f MB with %d clients (%.0f bytes per client)\n",
+               s.rssBefore / 1e6, s.rssReady / 1e6, clients, (s.rssReady - s.rssBefore) / clients);
+    }
+    if (_options.duration == 0)
+        return;
+    printf("recorded %.1f s after %.1f s warmup, target rate %.0f msg/s\n",
+           _options.duration, _options.warmup, _options.rate);
+    printf("%-24s %14lu  (%.0f msg/s)\n", "messages sent", s.sent, s.sent / _options.duration);
+    printf("%-24s %14lu  (%.0f msg/s)\n", "deliveries", s.received, s.received / _options.duration);
+    printf("%-24s %14lu\n", "deliveries missing", s.expected - (s.received < s.expected ? s.received : s.expected));
+    if (_options.abusers > 0) {
+        size_t line = _flood.size() / 64;
+        printf("%-24s %14lu  (%.0f msg/s from %d abusers)\n", "flood messages taken", s.flooded / line,
+               s.flooded / line / _options.duration, _options.abusers);
+    }
+    printf("%-24s %14d\n", "connections lost", s.closed);
+    if (s.syscalls >= 0)
+        printf("%-24s %14.0f  (%.2f per message, %.3f per delivery)\n", "server system calls", s.syscalls,
+               s.sent ? s.syscalls / s.sent : 0.0, s.received ? s.syscalls / s.received : 0.0);
+    printf("%-24s %8s %8s %8s %8s\n", "latency (us)", "p50", "p99", "p999", "max");
+    printf("%-24s %8.1f %8.1f %8.1f %8.1f\n", "",
+           s.latency.percentile(0.50) / 1e3, s.latency.percentile(0.99) / 1e3,
+           s.latency.percentile(0.999) / 1e3, s.latency.max() / 1e3);
+}
+
+// Parse one --name=value option. Returns false if invalid.
+static bool parseOption(const std::string& option, Options& options) {
+    size_t equal = option.find('=');
+    if (option.compare(0, 2, "--") != 0 || equal == std::string::npos)
+        return false;
+    std::string name = option.substr(2, equal - 2);
+    std::string value = option.substr(equal + 1);
+    const char* text = value.c_str();
+    char* end;
+
+    if (name == "host")
+        options.host = value;
+    else if (name == "password")
+        options.password = value;
+    else if (name == "backend")
+        return Poller::parseBackend(value, options.backend);
+    else if (name == "rate" || name == "warmup" || name == "duration") {
+        double number = strtod(text, &end);
+        if (value.empty() || *end != '\0' || number < 0)
+            return false;
+        (name == "rate" ? options.rate : name == "warmup" ? options.warmup : options.duration) = number;
+    } else if (name == "abusers") {
+        long number = strtol(text, &end, 10);
+        if (value.empty() || *end != '\0' || number < 0)
+            return false;
+        options.abusers = number;
+    } else if (name == "admin") {
+        long number = strtol(text, &end, 10);
+        if (value.empty() || *end != '\0' || number < 1 || number > 65535)
+            return false;
+        options.admin = number;
+    } else {
+        long number = strtol(text, &end, 10);
+        if (value.empty() || *end != '\0' || number < 1)
+            return false;
+        if (name == "port")
+            options.port = number;
+        else if (name == "clients")
+            options.clients = number;
+        else if (name == "channels")
+            options.channels = number;
+        else if (name == "joins")
+            options.joins = number;
+        else if (name == "size")
+            options.size = number;
+        else if (name == "in-flight")
+            options.inFlight = number;
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (!parseOption(argv[i], options)) {
+            fprintf(stderr, "Error: Invalid option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (options.rate <= 0) {
+        fprintf(stderr, "Error: --rate must be positive\n");
+        return 1;
+    }
+
+    Bench bench(options);
+    if (!bench.setUp())
+        return 1;
+    if (options.duration > 0)
+        bench.run();
+    bench.report();
+    return 0;
+}
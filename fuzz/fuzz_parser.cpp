@@ -0,0 +1,128 @@
+/**
+ * @brief Fuzz target for Parser::parse
+ *
+ * Checks invariants that must hold for any input: every token lies inside
+ * the line, there are at most 15 parameters, middle parameters contain no
+ * space and do not start with ':', and a successful parse always yields a
+ * valid command.
+ *
+ * Built with libFuzzer (make libfuzzer, needs clang) LLVMFuzzerTestOneInput
+ * is driven by the fuzzer. The default build adds a small standalone driver
+ * that replays the corpus and then runs deterministic random mutations of it,
+ * so the target also runs where libFuzzer is not available.
+ *
+ * Usage: ./fuzz_parser [iterations] corpus_file...
+ */
+#include "Parser.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static void check(bool condition, const char* what, const char* data, size_t size) {
+    if (condition)
+        return;
+    fprintf(stderr, "invariant failed: %s\ninput (%lu bytes): ", what, static_cast<unsigned long>(size));
+    fwrite(data, 1, size, stderr);
+    fprintf(stderr, "\n");
+    abort();
+}
+
+static bool inside(const Token& token, size_t size) {
+    return static_cast<size_t>(token.offset) + token.length <= size;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char* bytes, size_t size) {
+    const char* data = reinterpret_cast<const char*>(bytes);
+    Message message;
+    Parser::Result result = Parser::parse(data, size, message);
+    if (result != Parser::PARSE_OK)
+        return 0;
+
+    check(message.line == data, "line pointer", data, size);
+    check(inside(message.prefix, size), "prefix in bounds", data, size);
+    check(inside(message.command, size), "command in bounds", data, size);
+    check(message.command.length > 0, "command not empty", data, size);
+    check(message.paramCount <= Message::MAX_PARAMS, "param count", data, size);
+
+    StringRef command = message.getCommand();
+    for (size_t i = 0; i < command.length; ++i)
+        check(command[i] != ' ', "command has no space", data, size);
+
+    for (unsigned int i = 0; i < message.paramCount; ++i) {
+        check(inside(message.params[i], size), "param in bounds", data, size);
+        bool last = (i + 1 == message.paramCount);
+        if (last && (message.hasTrailing || message.paramCount == Message::MAX_PARAMS))
+            continue;
+        StringRef param = message.getParam(i);
+        check(param.length > 0, "middle param not empty", data, size);
+        check(param[0] != ':', "middle param has no colon", data, size);
+        check(std::memchr(param.data, ' ', param.length) == NULL, "middle param has no space", data, size);
+    }
+    return 0;
+}
+
+#ifndef USE_LIBFUZZER
+
+// Characters that matter to the grammar are picked more often
+static char randomByte() {
+    static const char special[] = { ' ', ':', '\r', '\n', '\0', '#', ',', '!', '@', '0' };
+    if (rand() % 2)
+        return special[rand() % sizeof(special)];
+    return static_cast<char>(rand() % 256);
+}
+
+static void mutate(std::string& input) {
+    int edits = 1 + rand() % 4;
+    for (int e = 0; e < edits; ++e) {
+        size_t pos = input.empty() ? 0 : rand() % (input.size() + 1);
+        switch (rand() % 4) {
+        case 0: input.insert(input.begin() + pos, randomByte()); break;
+        case 1: if (pos < input.size()) input.erase(pos, 1); break;
+        case 2: if (pos < input.size()) input[pos] = randomByte(); break;
+        default: input.insert(pos, input.substr(0, rand() % (input.size() + 1))); break;
+        }
+    }
+    if (input.size() > 600)
+        input.resize(600);
+}
+
+static void run(const std::string& input) {
+    LLVMFuzzerTestOneInput(reinterpret_cast<const unsigned char*>(input.data()), input.size());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s [iterations] corpus_file...\n", argv[0]);
+        return 1;
+    }
+    int first = 1;
+    long iterations = 200000;
+    if (argv[1][0] >= '0' && argv[1][0] <= '9') {
+        iterations = atol(argv[1]);
+        first = 2;
+    }
+
+    std::vector<std::string> corpus;
+    for (int i = first; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        corpus.push_back(std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+        run(corpus.back());
+    }
+    if (corpus.empty())
+        corpus.push_back("");
+
+    srand(1459);
+    for (long i = 0; i < iterations; ++i) {
+        std::string input = corpus[rand() % corpus.size()];
+        mutate(input);
+        run(input);
+    }
+    printf("%lu corpus inputs and %ld mutations passed\n", static_cast<unsigned long>(corpus.size()), iterations);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef IRCSERV_HPP
+#define IRCSERV_HPP
+
+/**
+ * @brief Common header shared by every module of the IRC server
+ *
+ * It pulls in the standard and POSIX headers the classes rely on and
+ * forward-declares the main classes so headers can refer to each other
+ * through pointers without circular includes.
+ */
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+
+// C headers (C++ wrappers)
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <ctime>
+
+// POSIX headers
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Forward declarations
+class Client;
+class Channel;
+
+// Generation-checked references to pooled objects (see SlabPool.hpp)
+#include "SlabPool.hpp"
+typedef Handle<Client> ClientHandle;
+typedef Handle<Channel> ChannelHandle;
+
+#endif
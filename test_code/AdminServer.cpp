@@ -0,0 +1,154 @@
+#include "AdminServer.hpp"
+#include "Server.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Largest request head read; the rest is ignored
+static const size_t MAX_REQUEST = 4096;
+
+// A scraper that stalls longer than this is dropped
+static const int REQUEST_TIMEOUT_SECONDS = 2;
+
+AdminServer::AdminServer(const Server &server) : _server(server), _listenFd(-1)
+{
+}
+
+AdminServer::~AdminServer()
+{
+    if (_listenFd != -1)
+        close(_listenFd);
+}
+
+void AdminServer::listen(int port)
+{
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listenFd == -1)
+    {
+        std::cerr << "Error: Cannot create admin socket" << std::endl;
+        exit(1);
+    }
+
+    int opt = 1;
+    if (setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1)
+    {
+        std::cerr << "Error: Cannot set admin socket options" << std::endl;
+        exit(1);
+    }
+
+    // Loopback only: the metrics are for a local agent, not for IRC users
+    struct sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    memset(address.sin_zero, 0, sizeof(address.sin_zero));
+
+    if (bind(_listenFd, (struct sockaddr *)&address, sizeof(address)) == -1)
+    {
+        std::cerr << "Error: Cannot bind admin socket" << std::endl;
+        exit(1);
+    }
+    if (::listen(_listenFd, 4) == -1)
+    {
+        std::cerr << "Error: Cannot listen on admin socket" << std::endl;
+        exit(1);
+    }
+}
+
+void AdminServer::spawn()
+{
+    if (pthread_create(&_thread, NULL, &AdminServer::threadMain, this) != 0)
+    {
+        std::cerr << "Error: Cannot start admin thread" << std::endl;
+        exit(1);
+    }
+}
+
+void *AdminServer::threadMain(void *admin)
+{
+    static_cast<AdminServer *>(admin)->run();
+    return NULL;
+}
+
+void AdminServer::run()
+{
+    while (true)
+    {
+        int fd = accept(_listenFd, NULL, NULL);
+        if (fd == -1)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+                Log::write(Log::LEVEL_ERROR, Log::CAT_ADMIN, "Cannot accept admin connection: %s", strerror(errno));
+            continue;
+        }
+        handleRequest(fd);
+        close(fd);
+    }
+}
+
+// Write a whole buffer to a blocking socket. Returns false on error.
+static bool writeAll(int fd, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Answer one HTTP request: GET /metrics (or /) returns the metrics
+void AdminServer::handleRequest(int fd)
+{
+    struct timeval timeout;
+    timeout.tv_sec = REQUEST_TIMEOUT_SECONDS;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Read the request head; only its first line matters
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST)
+    {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        request.append(buffer, n);
+    }
+    std::string line = request.substr(0, request.find("\r\n"));
+
+    std::string body;
+    std::string status;
+    if (line.compare(0, 13, "GET /metrics ") == 0 || line.compare(0, 6, "GET / ") == 0)
+    {
+        status = "200 OK";
+        _server.renderMetrics(body);
+    }
+    else
+    {
+        status = "404 Not Found";
+        body = "Try GET /metrics\n";
+    }
+
+    std::string response = "HTTP/1.0 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + Utils::intToString(static_cast<int>(body.size())) + "\r\n"
+                           "Connection: close\r\n\r\n";
+    if (writeAll(fd, response))
+        writeAll(fd, body);
+}
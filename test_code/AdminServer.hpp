@@ -0,0 +1,35 @@
+#ifndef ADMINSERVER_HPP
+#define ADMINSERVER_HPP
+
+#include <pthread.h>
+
+class Server;
+
+// Serves the server's metrics over HTTP on a loopback port, in the Prometheus
+// text format, from a thread of its own. Requests are answered one at a time
+// with blocking sockets: scrapes are rare and must never slow the event loops,
+// which only ever store to their counters.
+class AdminServer
+{
+private:
+    const Server &_server;
+    int _listenFd;
+    pthread_t _thread;
+
+    AdminServer(const AdminServer &);
+    AdminServer &operator=(const AdminServer &);
+
+    static void *threadMain(void *admin);
+
+    void run();
+    void handleRequest(int fd);
+
+public:
+    AdminServer(const Server &server);
+    ~AdminServer();
+
+    void listen(int port);
+    void spawn();
+};
+
+#endif
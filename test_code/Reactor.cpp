@@ -0,0 +1,908 @@
+#include "Reactor.hpp"
+#include "Server.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+#include "Command.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Maximum number of events handled per wakeup
+static const int MAX_EVENTS = 256;
+
+// Queued bytes after which a client's replies are written before reading more
+static const size_t EARLY_FLUSH_BYTES = 16 * 1024;
+
+// Resolution of the registration and keepalive deadlines
+static const unsigned long TIMER_TICK_MS = 100;
+
+Reactor::Reactor(const ServerConfig &config, ReactorHandler *handler)
+    : _config(config), _handler(handler), _hub(NULL), _poller(NULL), _ring(NULL), _iovsUsed(0), _msgsUsed(0),
+      _ringEnters(0), _listenFd(-1), _acceptPending(false), _now(Metrics::now() / 1000000),
+      _timers(_now, TIMER_TICK_MS), _recvPool(config.recvChunk)
+{
+}
+
+Reactor::Reactor(const ServerConfig &config, Mailbox *hub)
+    : _config(config), _handler(NULL), _hub(hub), _poller(NULL), _ring(NULL), _iovsUsed(0), _msgsUsed(0),
+      _ringEnters(0), _listenFd(-1), _acceptPending(false), _now(Metrics::now() / 1000000),
+      _timers(_now, TIMER_TICK_MS), _recvPool(config.recvChunk)
+{
+}
+
+Reactor::~Reactor()
+{
+    if (_listenFd != -1)
+        ::close(_listenFd);
+    delete _poller;
+    delete _ring;
+}
+
+void Reactor::listen(int port, bool reusePort)
+{
+    // Create socket
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listenFd == -1)
+    {
+        std::cerr << "Error: Cannot create socket" << std::endl;
+        exit(1);
+    }
+
+    // Set socket to non-blocking
+    if (fcntl(_listenFd, F_SETFL, O_NONBLOCK) == -1)
+    {
+        std::cerr << "Error: Cannot set socket to non-blocking" << std::endl;
+        exit(1);
+    }
+
+    // Allow port reuse
+    int opt = 1;
+    if (setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1)
+    {
+        std::cerr << "Error: Cannot set socket options" << std::endl;
+        exit(1);
+    }
+
+    // Every IO thread binds its own listener to the same port; the kernel
+    // spreads incoming connections between them
+    if (reusePort)
+    {
+#ifdef SO_REUSEPORT
+        if (setsockopt(_listenFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1)
+#endif
+        {
+            std::cerr << "Error: Cannot share the port between threads (SO_REUSEPORT)" << std::endl;
+            exit(1);
+        }
+    }
+
+    // Set up address structure
+    struct sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+    memset(address.sin_zero, 0, sizeof(address.sin_zero));
+
+    // Bind socket
+    if (bind(_listenFd, (struct sockaddr *)&address, sizeof(address)) == -1)
+    {
+        std::cerr << "Error: Cannot bind socket" << std::endl;
+        exit(1);
+    }
+
+    // Listen for connections; the backlog absorbs reconnect storms (the
+    // kernel caps it at net.core.somaxconn)
+    if (::listen(_listenFd, _config.listenBacklog) == -1)
+    {
+        std::cerr << "Error: Cannot listen on socket" << std::endl;
+        exit(1);
+    }
+
+    // Mail from the hub wakes us up through the inbox pipe
+    if (_hub && !_inbox.open())
+    {
+        std::cerr << "Error: Cannot create thread mailbox" << std::endl;
+        exit(1);
+    }
+
+    // io_uring watches the listener and the inbox itself; without kernel
+    // support we fall back to epoll
+    if (_config.backend == Poller::BACKEND_URING)
+    {
+        if (startRing())
+            return;
+        Log::write(Log::LEVEL_WARN, Log::CAT_CONNECTION, "io_uring is not available, falling back to epoll");
+    }
+
+    // Register the server socket; a NULL data pointer marks the listener
+    _poller = Poller::create(_config.backend);
+    if (!_poller->add(_listenFd, NULL, Poller::EV_READ))
+    {
+        std::cerr << "Error: Cannot watch server socket" << std::endl;
+        exit(1);
+    }
+    if (_hub && !_poller->add(_inbox.wakeupFd(), &_inbox, Poller::EV_READ))
+    {
+        std::cerr << "Error: Cannot create thread mailbox" << std::endl;
+        exit(1);
+    }
+    _events.resize(MAX_EVENTS);
+}
+
+// Run the event loop on a new thread (multi-threaded mode)
+void Reactor::spawn()
+{
+    if (pthread_create(&_thread, NULL, &Reactor::threadMain, this) != 0)
+    {
+        std::cerr << "Error: Cannot start IO thread" << std::endl;
+        exit(1);
+    }
+}
+
+void *Reactor::threadMain(void *reactor)
+{
+    static_cast<Reactor *>(reactor)->run();
+    return NULL;
+}
+
+void Reactor::run()
+{
+    while (true)
+    {
+        // Wait for sockets that are ready (or I/O that completed) and handle them
+        if (_ring)
+            waitRing();
+        else
+            waitPoller();
+
+        // Carry on with the clients whose read budget ran out
+        if (!_ready.empty())
+            runReady();
+
+        // Drop the clients that missed a deadline, ping the silent ones. Runs
+        // with no timer pending too, so the wheel's tick follows the clock
+        // through idle periods (advancing an empty wheel is a single jump).
+        expireTimers();
+
+        // Go back to the clients whose flood budget has refilled
+        if (!_throttled.empty())
+            resumeThrottled();
+
+        // Accept at most a budget per iteration, so a reconnect storm can't
+        // starve the clients already connected
+        if (_acceptPending)
+            acceptConnections();
+
+        // Write everything queued during this iteration, then close the
+        // sockets of the clients dropped during it
+        flushPending();
+        reap();
+    }
+}
+
+// Wait for events; only ready sockets are returned
+void Reactor::waitPoller()
+{
+    int event_count = _poller->wait(&_events[0], MAX_EVENTS, waitTimeout());
+    if (event_count == -1)
+    {
+        std::cerr << "Error: Poll failed" << std::endl;
+        exit(1);
+    }
+    _now = Metrics::now() / 1000000;
+    Metrics::add(_metrics.wakeups, 1);
+    Metrics::add(_metrics.syscalls, 1);
+    Metrics::add(_metrics.events, event_count);
+    _metrics.eventsPerWakeup.record(event_count);
+
+    for (int i = 0; i < event_count; ++i)
+    {
+        void *data = _events[i].data;
+        if (data == NULL)
+        {
+            // New connections: accepted below, after the clients
+            _acceptPending = true;
+        }
+        else if (data == &_inbox)
+        {
+            // Output and close requests from the hub
+            processMail();
+        }
+        else
+        {
+            Client *client = static_cast<Client *>(data);
+            // Dropped earlier in this batch: still allocated, but done with
+            if (!client->isAttached())
+                continue;
+            // Socket writable again: what is left in the queue goes out
+            // with the rest of this iteration's output, in one writev()
+            if (_events[i].events & Poller::EV_WRITE)
+                scheduleFlush(client);
+            // Client data
+            if (!(_events[i].events & (Poller::EV_READ | Poller::EV_HANGUP | Poller::EV_ERROR)))
+                continue;
+            // Waiting for its turn on the ready list, which reads it anyway
+            if (client->isReadyQueued())
+                continue;
+            if (!client->isThrottled())
+                handleClient(client);
+            else if (_events[i].events & (Poller::EV_HANGUP | Poller::EV_ERROR))
+                hangup(client, "Connection closed");
+        }
+    }
+}
+
+// How long the poller may sleep: not at all while connections are left over
+// from the last accept budget or clients from their read budget, and no later than the next timer or the first
+// throttled client due to be resumed
+int Reactor::waitTimeout() const
+{
+    if (_acceptPending || !_ready.empty())
+        return 0;
+
+    unsigned long first = _timers.nextExpiry();
+    for (size_t i = 0; i < _throttled.size(); ++i)
+    {
+        if (_throttled[i].resumeAt < first)
+            first = _throttled[i].resumeAt;
+    }
+    if (first == ULONG_MAX)
+        return -1;
+    unsigned long now = Metrics::now() / 1000000;
+    if (first <= now)
+        return 0;
+    return first - now > static_cast<unsigned long>(INT_MAX) ? INT_MAX : static_cast<int>(first - now);
+}
+
+// Accept pending connections until the queue is empty or the budget is spent
+void Reactor::acceptConnections()
+{
+    // Edge-triggered backends only report the listener once, so keep going
+    // until EAGAIN; if the budget runs out first, _acceptPending stays set
+    // and the next iteration carries on without waiting for a new event
+    for (int accepted = 0; accepted < _config.acceptBudget; ++accepted)
+    {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+#ifdef SOCK_NONBLOCK
+        // Non-blocking (and not inherited by exec) in the same system call
+        int client_fd = accept4(_listenFd, (struct sockaddr *)&client_addr, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        int client_fd = accept(_listenFd, (struct sockaddr *)&client_addr, &client_len);
+#endif
+        Metrics::add(_metrics.syscalls, 1);
+        if (client_fd == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                Log::write(Log::LEVEL_ERROR, Log::CAT_CONNECTION, "Cannot accept client: %s", strerror(errno));
+            _acceptPending = false;
+            return;
+        }
+
+#ifndef SOCK_NONBLOCK
+        // Set client socket to non-blocking
+        Metrics::add(_metrics.syscalls, 1);
+        if (fcntl(client_fd, F_SETFL, O_NONBLOCK) == -1)
+        {
+            Log::write(Log::LEVEL_ERROR, Log::CAT_CONNECTION, "Cannot set client socket to non-blocking: %s",
+                       strerror(errno));
+            ::close(client_fd);
+            continue;
+        }
+#endif
+        admit(client_fd, client_addr);
+    }
+}
+
+// Hand a new connection on: the hub (or Server) creates its Client
+void Reactor::admit(int client_fd, const struct sockaddr_in &client_addr)
+{
+    // Replies are already batched per iteration (one writev per client),
+    // so Nagle would only hold back the last segment of each batch
+    int one = 1;
+    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    Metrics::add(_metrics.syscalls, 1);
+
+    Metrics::add(_metrics.accepted, 1);
+    std::string hostname = inet_ntoa(client_addr.sin_addr);
+    Log::write(Log::LEVEL_DEBUG, Log::CAT_CONNECTION, "Accepted %d from %s", client_fd, hostname.c_str());
+    if (_hub)
+    {
+        // The hub creates the Client and mails it back to be attached
+        Mail *mail = new Mail(Mail::MAIL_CONNECT, NULL);
+        mail->fd = client_fd;
+        mail->replyTo = &_inbox;
+        mail->text = hostname;
+        _hub->post(mail);
+    }
+    else
+        _handler->onAccept(*this, client_fd, hostname);
+}
+
+// Start watching a client's socket; its output is flushed by this Reactor
+void Reactor::attach(Client *client)
+{
+    client->setSendqLimit(_config.sendqLimit);
+    client->setOutputListener(this);
+    client->setInputPool(&_recvPool);
+
+    int fd = client->getFd();
+    if (static_cast<size_t>(fd) >= _slots.size())
+        _slots.resize(fd + 1, NULL);
+    _slots[fd] = client;
+
+    // The poller hands this Client pointer back with every event
+    if (_ring)
+        watchRing(client);
+    else if (!_poller->add(fd, client, Poller::EV_READ))
+    {
+        Log::write(Log::LEVEL_ERROR, Log::CAT_CONNECTION, "Cannot watch client socket %d", fd);
+        _closing.push_back(client);
+        hangup(client, "Connection closed");
+        return;
+    }
+    client->setAttached(true);
+
+    // Give it until the registration deadline (or go straight to the keepalive)
+    client->setLastInput(_now);
+    client->getTimer().data = client;
+    if (_config.registerTimeout > 0)
+    {
+        client->setLiveness(LIVE_REGISTERING);
+        _timers.schedule(client->getTimer(), _now + _config.registerTimeout * 1000UL);
+    }
+    else
+    {
+        client->setLiveness(LIVE_IDLE);
+        scheduleKeepalive(client);
+    }
+}
+
+// The hub (or Server) saw the client register: its deadline is replaced by
+// the keepalive
+void Reactor::registered(Client *client)
+{
+    if (!client->isAttached() || client->getLiveness() != LIVE_REGISTERING)
+        return;
+    client->setLiveness(LIVE_IDLE);
+    scheduleKeepalive(client);
+}
+
+// Arm the timer for the end of the client's ping interval, counted from its
+// last input
+void Reactor::scheduleKeepalive(Client *client)
+{
+    if (_config.pingInterval > 0)
+        _timers.schedule(client->getTimer(), client->getLastInput() + _config.pingInterval * 1000UL);
+    else
+        _timers.cancel(client->getTimer());
+}
+
+// Handle the timers that are due
+void Reactor::expireTimers()
+{
+    _timers.advance(_now, _expired);
+    for (size_t i = 0; i < _expired.size(); ++i)
+        expire(static_cast<Client *>(_expired[i]->data));
+    _expired.clear();
+}
+
+// A client's timer fired: what it means depends on what it was waiting for
+void Reactor::expire(Client *client)
+{
+    // Dropped by an earlier timer of this batch (detach() cancels the others)
+    if (!client->isAttached())
+        return;
+    // Closed, but its last output is still not written: give up on it
+    if (_ring && _ringSlots[client->getFd()].draining)
+    {
+        detach(client);
+        return;
+    }
+
+    switch (client->getLiveness())
+    {
+    case LIVE_REGISTERING:
+        timeout(client, "Registration timeout");
+        break;
+    case LIVE_IDLE:
+        // Input since the timer was set pushes the PING back; only a silent
+        // client is pinged
+        if (_now - client->getLastInput() < _config.pingInterval * 1000UL)
+        {
+            scheduleKeepalive(client);
+            break;
+        }
+        deliverLine(client, std::string("PING :") + SERVER_NAME);
+        client->setLiveness(LIVE_PINGED);
+        _timers.schedule(client->getTimer(), _now + _config.pingTimeout * 1000UL);
+        break;
+    case LIVE_PINGED:
+        // Any input (not only PONG) would have set it back to LIVE_IDLE
+        timeout(client, "Ping timeout: " +
+                            Utils::intToString(static_cast<int>((_now - client->getLastInput()) / 1000)) +
+                            " seconds");
+        break;
+    }
+}
+
+// Drop a client that missed a deadline, telling it why
+void Reactor::timeout(Client *client, const std::string &reason)
+{
+    Metrics::add(_metrics.timeouts, 1);
+    Log::write(Log::LEVEL_DEBUG, Log::CAT_CONNECTION, "Timed out %d (%s)", client->getFd(), reason.c_str());
+    deliverLine(client, "ERROR :Closing Link: " + client->getHostname() + " (" + reason + ")");
+    if (flushClient(client))
+        hangup(client, reason);
+}
+
+// Stop watching a client's socket, without writing anything more. The socket
+// stays open until reap(), so its fd is not reused during this iteration.
+void Reactor::detach(Client *client)
+{
+    if (!client->isAttached())
+        return;
+    if (_ring)
+        unwatchRing(client);
+    else
+        _poller->remove(client->getFd());
+    client->setAttached(false);
+    _closing.push_back(client);
+    _timers.cancel(client->getTimer());
+    unlist(client);
+}
+
+// Take a client off the throttled and ready lists, as it may be freed at
+// the end of the iteration. Its ready slot is filled with the last client on
+// the list, so removal is constant time.
+void Reactor::unlist(Client *client)
+{
+    if (client->isThrottled())
+    {
+        unthrottle(client->getThrottleIndex());
+        client->setThrottled(false);
+    }
+
+    // A client in the turn being served is not on the ready list any more:
+    // runReady() skips it once the flag is cleared
+    if (client->isReadyQueued())
+    {
+        size_t index = client->getReadyIndex();
+        if (index < _ready.size() && _ready[index] == client)
+        {
+            _ready[index] = _ready.back();
+            _ready[index]->setReadyIndex(static_cast<unsigned int>(index));
+            _ready.pop_back();
+        }
+        client->setReadyQueued(false);
+    }
+}
+
+// Close the sockets of the clients detached during this iteration, and free
+// those whose owner already released them
+void Reactor::reap()
+{
+    for (size_t i = 0; i < _closing.size(); ++i)
+    {
+        Client *client = _closing[i];
+        // With io_uring, not while operations are still in flight on it
+        if (!_ring || !lingerRing(client->getFd()))
+            ::close(client->getFd());
+        _slots[client->getFd()] = NULL;
+        // The chunk goes back to the pool here: the client may be freed elsewhere
+        client->releaseInput();
+        Metrics::add(_metrics.closed, 1);
+        Log::write(Log::LEVEL_DEBUG, Log::CAT_CONNECTION, "Closed %d", client->getFd());
+        if (client->isReleased())
+            release(client);
+    }
+    _closing.clear();
+}
+
+// Hand a client whose socket is closed back to its owner, to be freed
+void Reactor::release(Client *client)
+{
+    if (_hub)
+        _hub->post(new Mail(Mail::MAIL_FREE, client));
+    else
+        _handler->onClosed(client);
+}
+
+// Write what is still queued (e.g. the ERROR line after QUIT), then close.
+// The owner is done with the client: it is released once the socket is closed.
+void Reactor::close(Client *client)
+{
+    if (client->isAttached())
+    {
+        // An io_uring send is in flight: its completion writes the rest of
+        // the queue, then detaches the client
+        if (_ring && _ringSlots[client->getFd()].sending && !client->isSendqExceeded())
+            drainRing(client);
+        else
+        {
+            if (!client->isSendqExceeded())
+            {
+                size_t queued = client->getSendqSize();
+                unsigned long writes = 0;
+                client->flushOutput(&writes);
+                Metrics::add(_metrics.writes, writes);
+                Metrics::add(_metrics.syscalls, writes);
+                Metrics::add(_metrics.bytesOut, queued - client->getSendqSize());
+            }
+            detach(client);
+        }
+    }
+
+    int fd = client->getFd();
+    if (static_cast<size_t>(fd) < _slots.size() && _slots[fd] == client)
+        client->setReleased(true);   // Socket closed at the end of this iteration
+    else
+        release(client);             // Already closed (hangup in an earlier iteration)
+}
+
+// The connection failed: tell whoever owns the client's state
+void Reactor::hangup(Client *client, const std::string &reason)
+{
+    if (_hub)
+    {
+        // The socket is useless now; the hub replies with MAIL_CLOSE
+        detach(client);
+        Mail *mail = new Mail(Mail::MAIL_HANGUP, client);
+        mail->text = reason;
+        _hub->post(mail);
+    }
+    else
+        _handler->onHangup(client, reason);
+}
+
+// Read a client's input and hand on its lines, within one turn's budget
+void Reactor::handleClient(Client *client)
+{
+    // Lines left over from its last turn go first
+    Budget budget = freshBudget();
+    if (!processLines(client, budget))
+        return;
+
+    // Read until the socket is drained (required by edge-triggered backends)
+    // or the budget is spent
+    while (budget.lines > 0 && budget.bytes > 0)
+    {
+        ssize_t bytes_received = readClient(client);
+        if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (bytes_received < 0 && errno == EINTR)
+            continue;
+        if (bytes_received <= 0)
+        {
+            // Client disconnected or error
+            hangup(client, "Connection closed");
+            return;
+        }
+        Metrics::add(_metrics.bytesIn, bytes_received);
+        budget.bytes -= std::min(budget.bytes, static_cast<size_t>(bytes_received));
+
+        // Alive: the keepalive timer catches up when it fires
+        client->setLastInput(_now);
+        if (client->getLiveness() == LIVE_PINGED)
+            client->setLiveness(LIVE_IDLE);
+
+        if (!processLines(client, budget))
+            return;
+        // Level-triggered backends report the socket again if more is left
+        if (_poller && !_poller->isEdgeTriggered() && budget.lines > 0)
+            return;
+    }
+
+    // Out of budget, maybe with input still buffered or in the socket
+    defer(client);
+}
+
+// Read from a client's socket into its line buffer (with io_uring, take what
+// was received for it). Same results as recv().
+ssize_t Reactor::readClient(Client *client)
+{
+    if (_ring)
+        return takeInput(client);
+    Metrics::add(_metrics.syscalls, 1);
+    return client->readInput();
+}
+
+// What a client may read and hand on in one turn
+Reactor::Budget Reactor::freshBudget() const
+{
+    Budget budget;
+    budget.bytes = _config.readBudget > 0 ? _config.readBudget : static_cast<size_t>(-1);
+    budget.lines = _config.commandBudget > 0 ? _config.commandBudget : INT_MAX;
+    return budget;
+}
+
+// Hand on the complete lines a client has buffered (a partial one stays in
+// the buffer), until the budget's lines are used up. Returns false if the
+// client must not be read from any more: it was disconnected, or it ran out
+// of flood budget.
+bool Reactor::processLines(Client *client, Budget &budget)
+{
+    StringRef line;
+    LineBuffer::Status status;
+    while (budget.lines > 0 && (status = client->nextLine(line)) != LineBuffer::LINE_NONE)
+    {
+        if (status == LineBuffer::LINE_TOO_LONG)
+        {
+            // Answered by the owner of the nickname, like any other numeric
+            if (_hub)
+                _hub->post(new Mail(Mail::MAIL_TOO_LONG, client));
+            else
+                _handler->onLineTooLong(client);
+            continue;
+        }
+        if (line.empty())
+            continue;
+        --budget.lines;
+
+        // Out of budget: keep the line for when the bucket has refilled
+        if (_config.floodRate > 0)
+        {
+            unsigned int cost = Command::cost(Command::lookupLine(line));
+            if (!client->getFloodBucket().take(cost, _now, _config.floodRate, _config.floodBurst))
+            {
+                client->unreadLine();
+                throttle(client, cost);
+                return false;
+            }
+        }
+
+        if (_hub)
+        {
+            Mail *mail = new Mail(Mail::MAIL_LINE, client);
+            mail->text.assign(line.data, line.length);
+            _hub->post(mail);
+        }
+        // QUIT or a fatal error: stop reading from this client
+        else if (!_handler->onLine(client, line))
+            return false;
+    }
+
+    // A client pipelining lots of commands builds up its own replies while
+    // we drain its socket; write them out early so they don't hit the sendq.
+    // A client over its sendq is dropped right away instead of reading on.
+    bool flushNow = client->isSendqExceeded() ||
+                    (client->getSendqSize() >= EARLY_FLUSH_BYTES && !client->isWriteArmed());
+    if (flushNow && !flushClient(client))
+        return false;
+    return true;
+}
+
+// Stop reading from a client until its bucket covers the line it stopped at.
+// Its output is still written.
+void Reactor::throttle(Client *client, unsigned int cost)
+{
+    Throttled entry;
+    entry.client = client;
+    entry.resumeAt = client->getFloodBucket().readyAt(cost, _config.floodRate);
+    client->setThrottleIndex(static_cast<unsigned int>(_throttled.size()));
+    _throttled.push_back(entry);
+    client->setThrottled(true);
+    // (io_uring keeps receiving until a few buffers are held, then stops)
+    if (_poller)
+        _poller->modify(client->getFd(), client, interestOf(client));
+    Metrics::add(_metrics.throttled, 1);
+    Log::write(Log::LEVEL_DEBUG, Log::CAT_CONNECTION, "Throttled %d for %lu ms", client->getFd(),
+               entry.resumeAt - _now);
+}
+
+// Resume the throttled clients that are due: run the lines they have
+// buffered, then watch their sockets again. The poller reports what arrived
+// meanwhile (epoll re-checks readiness when the interest is changed).
+void Reactor::resumeThrottled()
+{
+    size_t i = 0;
+    while (i < _throttled.size())
+    {
+        if (_throttled[i].resumeAt > _now)
+        {
+            ++i;
+            continue;
+        }
+        Client *client = _throttled[i].client;
+        unthrottle(i);
+        client->setThrottled(false);
+
+        // Throttled again, or disconnected: nothing to watch for now
+        Budget budget = freshBudget();
+        if (!processLines(client, budget))
+            continue;
+        // io_uring doesn't report what it received meanwhile again: that is
+        // read on the client's next turn
+        if (_poller)
+            _poller->modify(client->getFd(), client, interestOf(client));
+        if (budget.lines == 0 || _ring)
+            defer(client);
+    }
+}
+
+// Take an entry off the throttled list, moving the last one into its place
+void Reactor::unthrottle(size_t index)
+{
+    _throttled[index] = _throttled.back();
+    _throttled[index].client->setThrottleIndex(static_cast<unsigned int>(index));
+    _throttled.pop_back();
+}
+
+// Put a client whose budget ran out at the end of the ready list, to be read
+// again after the next poller wait (which doesn't block while the list has
+// clients)
+void Reactor::defer(Client *client)
+{
+    client->setReadyQueued(true);
+    client->setReadyIndex(static_cast<unsigned int>(_ready.size()));
+    _ready.push_back(client);
+    Metrics::add(_metrics.deferred, 1);
+}
+
+// Give every client on the ready list another turn. Those that use up their
+// budget again go back on the list for the next iteration, behind the
+// clients whose events come in meanwhile.
+void Reactor::runReady()
+{
+    _readyTurn.swap(_ready);
+    for (size_t i = 0; i < _readyTurn.size(); ++i)
+    {
+        Client *client = _readyTurn[i];
+        // Dropped during this turn: still allocated until reap()
+        if (!client->isReadyQueued())
+            continue;
+        client->setReadyQueued(false);
+        handleClient(client);
+    }
+    _readyTurn.clear();
+}
+
+// Queue a line the Reactor itself sends (not the hub); flushed with the rest
+// of the iteration's output
+void Reactor::deliverLine(Client *client, const std::string &line)
+{
+    Payload *frame = Payload::createLine(line);
+    client->deliverOutput(frame);
+    frame->release();
+}
+
+// Poller events a client needs: input unless it is throttled, and
+// writability while output is stuck in its queue
+unsigned int Reactor::interestOf(const Client *client) const
+{
+    return (client->isThrottled() ? 0 : Poller::EV_READ) | (client->isWriteArmed() ? Poller::EV_WRITE : 0);
+}
+
+// Write a client's queued output. Returns false if the client was disconnected.
+bool Reactor::flushClient(Client *client)
+{
+    if (client->isSendqExceeded())
+    {
+        Log::write(Log::LEVEL_WARN, Log::CAT_SENDQ, "SendQ exceeded for client %d (%lu bytes queued)",
+                   client->getFd(), static_cast<unsigned long>(client->getSendqSize()));
+        hangup(client, "SendQ exceeded");
+        return false;
+    }
+
+    // Sent asynchronously: errors are reported by the completion
+    if (_ring)
+    {
+        sendRing(client);
+        return true;
+    }
+
+    size_t queued = client->getSendqSize();
+    _metrics.sendqDepth.record(queued);
+    unsigned long writes = 0;
+    SendQueue::FlushResult result = client->flushOutput(&writes);
+    Metrics::add(_metrics.writes, writes);
+    Metrics::add(_metrics.syscalls, writes);
+    Metrics::add(_metrics.bytesOut, queued - client->getSendqSize());
+    if (result == SendQueue::FLUSH_ERROR)
+    {
+        hangup(client, "Write error");
+        return false;
+    }
+
+    // Only ask for write notifications while data is stuck in the queue
+    bool wantWrite = (result == SendQueue::FLUSH_AGAIN);
+    if (wantWrite != client->isWriteArmed())
+    {
+        client->setWriteArmed(wantWrite);
+        _poller->modify(client->getFd(), client, interestOf(client));
+    }
+    return true;
+}
+
+// Write a client's queue at the end of the iteration, with whatever else it
+// is sent meanwhile
+void Reactor::scheduleFlush(Client *client)
+{
+    if (client->isFlushScheduled())
+        return;
+    client->setFlushScheduled(true);
+    _pendingFlush.push_back(client);
+}
+
+// Flush every client that queued output during this loop iteration
+void Reactor::flushPending()
+{
+    while (!_pendingFlush.empty())
+    {
+        Client *client = _pendingFlush.back();
+        _pendingFlush.pop_back();
+        client->setFlushScheduled(false);
+        // Dropped since it queued output (its send queue was written by close())
+        if (client->isAttached())
+            flushClient(client);
+    }
+}
+
+// Handle the mail sent by the hub since the last wakeup
+void Reactor::processMail()
+{
+    _inbox.acknowledge();
+    Mail *mail;
+    while ((mail = _inbox.take()) != NULL)
+    {
+        Client *client = mail->client;
+        switch (mail->type)
+        {
+        case Mail::MAIL_ATTACH:
+            attach(client);
+            break;
+        case Mail::MAIL_OUTPUT:
+            // Output for a socket we already closed is dropped
+            if (client->isAttached())
+                client->deliverOutput(mail->payload);
+            break;
+        case Mail::MAIL_REGISTERED:
+            registered(client);
+            break;
+        case Mail::MAIL_CLOSE:
+            // Nothing for this client can follow: the hub frees it when we
+            // answer with MAIL_FREE, once its socket is closed
+            close(client);
+            break;
+        default:
+            break;
+        }
+        if (mail->payload)
+            mail->payload->release();
+        delete mail;
+    }
+}
+
+const char *Reactor::backendName() const
+{
+    return _ring ? "io_uring" : _poller->name();
+}
+
+// Every client whose socket is still open
+void Reactor::getClients(std::vector<Client *> &clients) const
+{
+    for (size_t fd = 0; fd < _slots.size(); ++fd)
+    {
+        if (_slots[fd])
+            clients.push_back(_slots[fd]);
+    }
+}
+
+const IoMetrics &Reactor::getMetrics() const
+{
+    return _metrics;
+}
+
+void Reactor::onOutputQueued(Client *client)
+{
+    _pendingFlush.push_back(client);
+}
@@ -0,0 +1,237 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "Poller.hpp"
+#include "IoUring.hpp"
+#include "RecvPool.hpp"
+#include "Client.hpp"
+#include "Mailbox.hpp"
+#include "Metrics.hpp"
+#include "TimerWheel.hpp"
+
+class Reactor;
+struct ServerConfig;
+
+// Receives what a Reactor reads from its connections (single-threaded mode)
+class ReactorHandler
+{
+public:
+    virtual ~ReactorHandler() {}
+    // A connection was accepted; the handler creates its Client and attaches it
+    virtual void onAccept(Reactor &reactor, int fd, const std::string &hostname) = 0;
+    // One complete line; returns false if the client was disconnected
+    virtual bool onLine(Client *client, const StringRef &line) = 0;
+    // A line over the length limit was dropped
+    virtual void onLineTooLong(Client *client) = 0;
+    // The connection failed (EOF, write error, sendq exceeded)
+    virtual void onHangup(Client *client, const std::string &reason) = 0;
+    // A client given to close() has its socket closed: it can be freed
+    virtual void onClosed(Client *client) = 0;
+};
+
+/**
+ * Event loop for a set of connections: accepts them on its own listening
+ * socket, frames their input into lines and writes their send queues.
+ *
+ * In single-threaded mode the Server runs one Reactor and handles its events
+ * directly through ReactorHandler. In multi-threaded mode every IO thread runs
+ * a Reactor bound to its own SO_REUSEPORT listener, and events travel as Mail:
+ * to the hub's mailbox for what was read, from the Reactor's inbox for what to
+ * write and which sockets to close.
+ *
+ * Clients are found by file descriptor in a slot table. A client that is
+ * dropped stops being watched at once, but its socket is only closed, and the
+ * Client only freed, at the end of the loop iteration (reap()): events already
+ * returned for it in the same batch are skipped instead of touching freed
+ * memory, its fd can't be reused by a connection accepted meanwhile, and
+ * dropping k clients costs O(k) however many are connected.
+ *
+ * Flood control: every line is charged its command's cost against the
+ * client's token bucket before it is handed on. A client that runs out is
+ * not disconnected; the line waits in its input buffer and the Reactor stops
+ * watching the socket for input until the bucket has refilled, so the
+ * client's own TCP window fills up and the kernel pushes back on it. The
+ * others keep being served in the meantime.
+ *
+ * Deadlines: every client has one timer in the Reactor's timing wheel. It
+ * first holds the registration deadline, then the keepalive: a client silent
+ * for the ping interval is sent a PING, and dropped if it still says nothing
+ * before the ping timeout. Reads only store the time; the timer is moved when
+ * it fires, so a busy client costs nothing. The poller sleeps until the next
+ * deadline instead of scanning the clients.
+ *
+ * Read budget: a client is read from for at most readBudget bytes and
+ * commandBudget lines per iteration. One that still has input after that is
+ * put on the ready list and carried on with after the poller's events (its
+ * socket is not reported again by edge-triggered backends), then at the end
+ * of the list on later iterations, until it is drained. A bulk sender keeps
+ * its throughput, but can no longer hold up everyone else's turn.
+ *
+ * io_uring (--backend=io_uring, see ReactorUring.cpp): instead of waiting for
+ * readiness and then making a system call per socket, the loop keeps a
+ * multishot accept on the listener and a multishot recv on every client, and
+ * queues its writes as sendmsg() operations; one io_uring_enter() per
+ * iteration submits them and collects what completed. Received data lands in
+ * a shared ring of provided buffers and is held per client until its turn
+ * copies it into the line buffer, so the budgets and flood control above work
+ * unchanged. A socket with operations still in flight is only closed once
+ * they have completed. Without kernel support the Reactor uses epoll.
+ *
+ * Receive memory: clients read into chunks of the Reactor's RecvPool, held
+ * only while they have part of a line buffered (see LineBuffer). A client's
+ * chunk goes back to the pool when its socket is closed, on this thread.
+ */
+class Reactor : public OutputListener
+{
+private:
+    struct Throttled
+    {
+        Client *client;
+        unsigned long resumeAt;           // When its bucket covers the line it stopped at
+    };
+
+    struct Budget
+    {
+        size_t bytes;                     // Left to read this turn
+        int lines;                        // Left to hand on this turn
+    };
+
+    // io_uring: received data not yet copied into the client's line buffer
+    struct HeldBuffer
+    {
+        unsigned int id;                  // Provided buffer holding it
+        unsigned int offset;
+        unsigned int length;
+    };
+
+    enum RecvState
+    {
+        RECV_IDLE,                        // No recv in flight
+        RECV_ARMED,                       // Multishot recv delivering data
+        RECV_CANCELLING                   // Enough held: stopped until the client catches up
+    };
+
+    // io_uring state of a socket, by file descriptor (outlives its Client
+    // while operations are in flight)
+    struct RingSlot
+    {
+        int pending;                      // Operations in flight on the socket
+        RecvState recv;
+        bool sending;                     // A sendmsg() is in flight
+        bool eof;                         // Peer closed or the socket failed: hang up once drained
+        bool lingering;                   // Reaped: closed once pending reaches 0
+        bool draining;                    // Closed with a send in flight: detached once its queue is written
+        std::vector<HeldBuffer> held;     // Received, oldest first
+        std::vector<Payload *> pinned;    // Payloads the in-flight send reads from (one reference each)
+
+        RingSlot() : pending(0), recv(RECV_IDLE), sending(false), eof(false), lingering(false), draining(false) {}
+    };
+
+
+    const ServerConfig &_config;
+    ReactorHandler *_handler;             // Single-threaded mode
+    Mailbox *_hub;                        // Multi-threaded mode: mail for the hub
+    Mailbox _inbox;                       // Multi-threaded mode: mail from the hub
+    Poller *_poller;                      // Readiness notifications (epoll or poll), NULL with io_uring
+    IoUring *_ring;                       // io_uring backend, NULL with a Poller
+    std::vector<RingSlot> _ringSlots;     // io_uring state by file descriptor
+    std::vector<int> _starved;            // Sockets whose recv stopped for lack of buffers
+    std::vector<struct iovec> _iovs;      // Send arena: iovecs of the sendmsg() calls not yet submitted
+    std::vector<struct msghdr> _msgs;
+    std::vector<Payload *> _gathered;     // Scratch for the payloads behind a send's iovecs
+    size_t _iovsUsed;
+    size_t _msgsUsed;
+    std::vector<IoUring::Completion> _completions;  // Completions handled by one wakeup
+    unsigned long _ringEnters;            // io_uring_enter() calls already counted in _metrics
+    int _listenFd;
+    bool _acceptPending;                  // Listener may still have connections (budget ran out)
+    std::vector<Poller::Event> _events;   // Events returned by one wakeup
+    std::vector<Client *> _slots;         // Clients by file descriptor, until their socket is closed
+    std::vector<Client *> _closing;       // Detached this iteration, closed by reap()
+    std::vector<Client *> _pendingFlush;  // Clients with output queued this iteration
+    std::vector<Throttled> _throttled;    // Clients out of flood budget, not read from
+    std::vector<Client *> _ready;         // Clients out of read budget with input left, in turn order
+    std::vector<Client *> _readyTurn;     // The ready list being served this iteration
+    unsigned long _now;                   // Time of the last wakeup, in milliseconds
+    TimerWheel _timers;                   // Registration deadlines and keepalives
+    std::vector<Timer *> _expired;        // Timers due this iteration
+    RecvPool _recvPool;                   // Input memory of the clients with an unfinished line
+    pthread_t _thread;
+    IoMetrics _metrics;                   // Written by this loop only
+
+    Reactor(const Reactor &);
+    Reactor &operator=(const Reactor &);
+
+    static void *threadMain(void *reactor);
+
+    void waitPoller();
+    void acceptConnections();
+    void admit(int fd, const struct sockaddr_in &address);
+    void handleClient(Client *client);
+    ssize_t readClient(Client *client);
+    Budget freshBudget() const;
+    bool processLines(Client *client, Budget &budget);
+    void defer(Client *client);
+    void runReady();
+    void throttle(Client *client, unsigned int cost);
+    void resumeThrottled();
+    void unthrottle(size_t index);
+    int waitTimeout() const;
+    void expireTimers();
+    void expire(Client *client);
+    void scheduleKeepalive(Client *client);
+    void timeout(Client *client, const std::string &reason);
+    void deliverLine(Client *client, const std::string &line);
+    unsigned int interestOf(const Client *client) const;
+    bool flushClient(Client *client);
+    void scheduleFlush(Client *client);
+    void flushPending();
+    void detach(Client *client);
+    void unlist(Client *client);
+    void reap();
+    void release(Client *client);
+    void hangup(Client *client, const std::string &reason);
+    void processMail();
+
+    // io_uring backend (ReactorUring.cpp)
+    bool startRing();
+    void waitRing();
+    void complete(const IoUring::Completion &completion);
+    void completeRecv(int fd, const IoUring::Completion &completion);
+    void completeSend(int fd, const IoUring::Completion &completion);
+    void settle(int fd);
+    void armRecv(int fd);
+    ssize_t takeInput(Client *client);
+    void sendRing(Client *client);
+    void submitEarly();
+    void watchRing(Client *client);
+    void unwatchRing(Client *client);
+    void drainRing(Client *client);
+    void stopRecv(int fd);
+    bool lingerRing(int fd);
+
+public:
+    Reactor(const ServerConfig &config, ReactorHandler *handler);
+    Reactor(const ServerConfig &config, Mailbox *hub);
+    ~Reactor();
+
+    void listen(int port, bool reusePort);
+    void run();
+    void spawn();
+
+    void attach(Client *client);
+    void close(Client *client);
+    void registered(Client *client);
+
+    const char *backendName() const;
+    void getClients(std::vector<Client *> &clients) const;
+    const IoMetrics &getMetrics() const;
+    virtual void onOutputQueued(Client *client);
+};
+
+#endif
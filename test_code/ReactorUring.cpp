@@ -0,0 +1,418 @@
+#include "Reactor.hpp"
+#include "Log.hpp"
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+// Submission ring size (the completion ring is 8 times larger)
+static const unsigned int RING_ENTRIES = 1024;
+
+// Receive buffers shared by all the sockets of a Reactor (copied into the
+// clients' RecvPool chunks on their turn)
+static const unsigned int RING_BUFFERS = 1024;
+static const unsigned int RING_BUFFER_SIZE = 4096;
+
+// Buffers held for a client before its recv is stopped (it is behind: out of
+// read or flood budget)
+static const size_t MAX_HELD = 4;
+
+// How long a closed client's last output may take to be written (see
+// drainRing()), in milliseconds
+static const unsigned long DRAIN_TIMEOUT = 10000;
+
+// Completions handled per wakeup; the rest wait for the next iteration
+static const int MAX_COMPLETIONS = 1024;
+
+// iovecs per sendmsg() (the kernel's limit), and room for the sends of one
+// iteration before they are submitted early
+static const int MAX_SEND_IOV = 1024;
+static const size_t SEND_ARENA_IOVS = 8 * MAX_SEND_IOV;
+static const size_t SEND_ARENA_MSGS = 1024;
+
+// Operation kinds, in the low bits of a tag (the fd is in the others)
+enum
+{
+    TAG_ACCEPT,
+    TAG_INBOX,
+    TAG_RECV,
+    TAG_SEND,
+    TAG_CANCEL
+};
+
+static unsigned long long tagOf(int fd, int kind)
+{
+    return (static_cast<unsigned long long>(fd) << 3) | kind;
+}
+
+// Set up io_uring instead of a Poller. Returns false if the kernel lacks what
+// it needs.
+bool Reactor::startRing()
+{
+    if (!IoUring::isSupported())
+        return false;
+    IoUring *ring = new IoUring();
+    if (!ring->open(RING_ENTRIES) || !ring->provideBuffers(RING_BUFFERS, RING_BUFFER_SIZE))
+    {
+        delete ring;
+        return false;
+    }
+    _ring = ring;
+    _ring->acceptMultishot(_listenFd, tagOf(_listenFd, TAG_ACCEPT));
+    if (_hub)
+        _ring->pollMultishot(_inbox.wakeupFd(), tagOf(_inbox.wakeupFd(), TAG_INBOX));
+    _iovs.resize(SEND_ARENA_IOVS);
+    _msgs.resize(SEND_ARENA_MSGS);
+    _gathered.resize(MAX_SEND_IOV);
+    _completions.reserve(MAX_COMPLETIONS);
+    return true;
+}
+
+// Submit this iteration's operations, wait for completions and handle them
+void Reactor::waitRing()
+{
+    // Buffers were given back since these sockets ran out: receive again
+    if (!_starved.empty() && _ring->freeBuffers() > 0)
+    {
+        std::vector<int> starved;
+        starved.swap(_starved);
+        for (size_t i = 0; i < starved.size(); ++i)
+        {
+            Client *client = _slots[starved[i]];
+            if (client && client->isAttached())
+                armRecv(starved[i]);
+        }
+    }
+
+    if (!_ring->submit(waitTimeout()))
+    {
+        std::cerr << "Error: io_uring_enter failed" << std::endl;
+        exit(1);
+    }
+    // The kernel copied the sendmsg() headers on submission
+    _iovsUsed = 0;
+    _msgsUsed = 0;
+    _now = Metrics::now() / 1000000;
+    Metrics::add(_metrics.wakeups, 1);
+    Metrics::add(_metrics.syscalls, _ring->enterCount() - _ringEnters);
+    _ringEnters = _ring->enterCount();
+
+    IoUring::Completion completion;
+    while (_completions.size() < static_cast<size_t>(MAX_COMPLETIONS) && _ring->nextCompletion(completion))
+        _completions.push_back(completion);
+    Metrics::add(_metrics.events, _completions.size());
+    _metrics.eventsPerWakeup.record(_completions.size());
+
+    // Sends first: a client closed further down the batch gets its last
+    // lines written, instead of finding the previous send still in flight
+    for (size_t i = 0; i < _completions.size(); ++i)
+    {
+        if ((_completions[i].tag & 7) == TAG_SEND)
+            complete(_completions[i]);
+    }
+    for (size_t i = 0; i < _completions.size(); ++i)
+    {
+        if ((_completions[i].tag & 7) != TAG_SEND)
+            complete(_completions[i]);
+    }
+    _completions.clear();
+}
+
+// Handle one completion
+void Reactor::complete(const IoUring::Completion &completion)
+{
+    int fd = static_cast<int>(completion.tag >> 3);
+    switch (completion.tag & 7)
+    {
+    case TAG_ACCEPT:
+        if (completion.result >= 0)
+        {
+            struct sockaddr_in address;
+            socklen_t length = sizeof(address);
+            // The accept itself went through the ring, but this doesn't
+            if (getpeername(completion.result, (struct sockaddr *)&address, &length) == -1)
+                memset(&address, 0, sizeof(address));
+            Metrics::add(_metrics.syscalls, 1);
+            admit(completion.result, address);
+        }
+        else if (completion.result != -ECONNABORTED)
+            Log::write(Log::LEVEL_ERROR, Log::CAT_CONNECTION, "Cannot accept client: %s", strerror(-completion.result));
+        if (!completion.hasMore())
+            _ring->acceptMultishot(_listenFd, completion.tag);
+        break;
+    case TAG_INBOX:
+        // Output and close requests from the hub
+        processMail();
+        if (!completion.hasMore())
+            _ring->pollMultishot(fd, completion.tag);
+        break;
+    case TAG_RECV:
+        completeRecv(fd, completion);
+        break;
+    case TAG_SEND:
+        completeSend(fd, completion);
+        break;
+    case TAG_CANCEL:
+        --_ringSlots[fd].pending;
+        settle(fd);
+        break;
+    }
+}
+
+// Data (or the end of the stream) received for a socket: held until the
+// client's turn copies it into its line buffer
+void Reactor::completeRecv(int fd, const IoUring::Completion &completion)
+{
+    RingSlot &slot = _ringSlots[fd];
+    if (!completion.hasMore())
+    {
+        slot.recv = RECV_IDLE;
+        --slot.pending;
+    }
+
+    Client *client = _slots[fd];
+    bool live = client && client->isAttached() && !slot.draining;
+    if (completion.hasBuffer())
+    {
+        if (live)
+        {
+            HeldBuffer held = { completion.buffer(), 0, static_cast<unsigned int>(completion.result) };
+            slot.held.push_back(held);
+        }
+        else
+            _ring->recycle(completion.buffer());
+    }
+    else if (completion.result == -ENOBUFS)
+    {
+        if (live)
+            _starved.push_back(fd);
+    }
+    else if (completion.result != -ECANCELED)
+    {
+        // 0 at the end of the stream, or a socket error
+        slot.eof = true;
+    }
+    if (!live)
+    {
+        settle(fd);
+        return;
+    }
+
+    // Enough held for the client's next turns: stop receiving, so its TCP
+    // window fills up and the kernel pushes back on it
+    if (slot.held.size() >= MAX_HELD && slot.recv == RECV_ARMED)
+    {
+        _ring->cancel(tagOf(fd, TAG_RECV), tagOf(fd, TAG_CANCEL));
+        slot.recv = RECV_CANCELLING;
+        ++slot.pending;
+    }
+
+    // From here on, as for a readable socket
+    if (client->isReadyQueued())
+        return;
+    if (!client->isThrottled())
+        handleClient(client);
+    else if (slot.eof)
+        hangup(client, "Connection closed");
+}
+
+// A send completed: drop what it wrote from the queue, and send the rest
+void Reactor::completeSend(int fd, const IoUring::Completion &completion)
+{
+    RingSlot &slot = _ringSlots[fd];
+    slot.sending = false;
+    --slot.pending;
+    for (size_t i = 0; i < slot.pinned.size(); ++i)
+        slot.pinned[i]->release();
+    slot.pinned.clear();
+
+    Client *client = _slots[fd];
+    if (client && client->isAttached())
+    {
+        if (completion.result < 0)
+        {
+            // A closed client is only waiting for its output: drop it
+            if (slot.draining)
+                detach(client);
+            else if (completion.result != -ECANCELED)
+                hangup(client, "Write error");
+        }
+        else
+        {
+            Metrics::add(_metrics.bytesOut, completion.result);
+            client->consumeOutput(completion.result);
+            // A short write (socket buffer full), or output queued meanwhile
+            if (client->hasPendingOutput())
+                scheduleFlush(client);
+            else if (slot.draining)
+                detach(client);
+        }
+    }
+    settle(fd);
+}
+
+// Close a reaped socket once nothing is in flight on it any more
+void Reactor::settle(int fd)
+{
+    RingSlot &slot = _ringSlots[fd];
+    if (slot.lingering && slot.pending == 0)
+    {
+        ::close(fd);
+        slot.lingering = false;
+    }
+}
+
+// Start a multishot recv on a socket, unless one is running or the client
+// has enough held already
+void Reactor::armRecv(int fd)
+{
+    RingSlot &slot = _ringSlots[fd];
+    if (slot.recv != RECV_IDLE || slot.eof || slot.draining || slot.held.size() >= MAX_HELD)
+        return;
+    if (_ring->freeBuffers() == 0)
+    {
+        _starved.push_back(fd);
+        return;
+    }
+    _ring->recvMultishot(fd, tagOf(fd, TAG_RECV));
+    slot.recv = RECV_ARMED;
+    ++slot.pending;
+}
+
+// Copy held data into a client's line buffer, like one recv(): bytes copied,
+// 0 at the end of the stream, or -1 with EAGAIN once nothing is held
+ssize_t Reactor::takeInput(Client *client)
+{
+    int fd = client->getFd();
+    RingSlot &slot = _ringSlots[fd];
+    if (slot.held.empty())
+    {
+        if (slot.eof)
+            return 0;
+        // Caught up: receive again if it was stopped
+        armRecv(fd);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    HeldBuffer &front = slot.held.front();
+    size_t copied = client->appendInput(_ring->bufferData(front.id) + front.offset, front.length);
+    if (copied == 0)
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+    front.offset += copied;
+    front.length -= copied;
+    if (front.length == 0)
+    {
+        _ring->recycle(front.id);
+        slot.held.erase(slot.held.begin());
+    }
+    return static_cast<ssize_t>(copied);
+}
+
+// Queue a sendmsg() of a client's output, unless one is in flight (its
+// completion sends the rest). The payloads it reads from are retained until
+// then: the queue may be cleared meanwhile.
+void Reactor::sendRing(Client *client)
+{
+    int fd = client->getFd();
+    if (_ringSlots[fd].sending || !client->hasPendingOutput())
+        return;
+    if (_iovsUsed + MAX_SEND_IOV > _iovs.size() || _msgsUsed == _msgs.size())
+        submitEarly();
+
+    RingSlot &slot = _ringSlots[fd];
+    struct iovec *iov = &_iovs[_iovsUsed];
+    int count = client->gatherOutput(iov, &_gathered[0], MAX_SEND_IOV);
+    _iovsUsed += count;
+    for (int i = 0; i < count; ++i)
+    {
+        _gathered[i]->retain();
+        slot.pinned.push_back(_gathered[i]);
+    }
+
+    struct msghdr &message = _msgs[_msgsUsed++];
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = count;
+    _ring->sendmsg(fd, &message, tagOf(fd, TAG_SEND));
+    slot.sending = true;
+    ++slot.pending;
+    _metrics.sendqDepth.record(client->getSendqSize());
+    Metrics::add(_metrics.writes, 1);
+}
+
+// The send arena is full: submit what was prepared so it can be reused
+void Reactor::submitEarly()
+{
+    if (!_ring->submit(0))
+    {
+        std::cerr << "Error: io_uring_enter failed" << std::endl;
+        exit(1);
+    }
+    _iovsUsed = 0;
+    _msgsUsed = 0;
+}
+
+// Start receiving from a newly attached client
+void Reactor::watchRing(Client *client)
+{
+    int fd = client->getFd();
+    if (static_cast<size_t>(fd) >= _ringSlots.size())
+        _ringSlots.resize(fd + 1);
+    // The fd was closed, so nothing is left in flight from its last owner
+    _ringSlots[fd].recv = RECV_IDLE;
+    _ringSlots[fd].eof = false;
+    _ringSlots[fd].draining = false;
+    armRecv(fd);
+}
+
+// Stop receiving on a detached client's socket. A send in flight is left
+// to complete: the socket lingers until then (see lingerRing()).
+void Reactor::unwatchRing(Client *client)
+{
+    stopRecv(client->getFd());
+}
+
+// The owner closed a client while a send is in flight on its socket. Instead
+// of cancelling it and losing what is queued behind it (e.g. the ERROR line
+// after QUIT), stop reading and keep the client attached: each send
+// completion writes more of the queue, and the client is detached once it
+// is empty, or after DRAIN_TIMEOUT if the peer stops reading.
+void Reactor::drainRing(Client *client)
+{
+    int fd = client->getFd();
+    _ringSlots[fd].draining = true;
+    stopRecv(fd);
+    unlist(client);
+    _timers.schedule(client->getTimer(), _now + DRAIN_TIMEOUT);
+}
+
+// Cancel a socket's recv, and give back what it had received
+void Reactor::stopRecv(int fd)
+{
+    RingSlot &slot = _ringSlots[fd];
+    if (slot.recv == RECV_ARMED)
+    {
+        _ring->cancel(tagOf(fd, TAG_RECV), tagOf(fd, TAG_CANCEL));
+        slot.recv = RECV_CANCELLING;
+        ++slot.pending;
+    }
+    for (size_t i = 0; i < slot.held.size(); ++i)
+        _ring->recycle(slot.held[i].id);
+    slot.held.clear();
+}
+
+// Called by reap(): true if the socket must stay open until what is in
+// flight on it completes (settle() closes it then)
+bool Reactor::lingerRing(int fd)
+{
+    RingSlot &slot = _ringSlots[fd];
+    if (slot.pending == 0)
+        return false;
+    slot.lingering = true;
+    return true;
+}
@@ -1,157 +1,321 @@
 #include "Server.hpp"
-#include <fcntl.h>
+#include "Client.hpp"
+#include "Channel.hpp"
+#include "Utils.hpp"
+#include <poll.h>
 #include <unistd.h>
-#include <arpa/inet.h>
-#include <cstring>
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
 
-Server::Server(int port, const std::string &password) : _port(port), _password(password), _server_fd(-1) {}
+// Room for a burst of reconnecting clients (Linux caps it at net.core.somaxconn)
+static const int DEFAULT_LISTEN_BACKLOG = 4096;
 
-Server::~Server()
+// Enough to keep up with a storm, small enough not to stall connected clients
+static const int DEFAULT_ACCEPT_BUDGET = 64;
+
+// About 20 messages a second, with room for registering and joining a few
+// channels at once (see Command::cost())
+static const unsigned int DEFAULT_FLOOD_RATE = 40;
+static const unsigned int DEFAULT_FLOOD_BURST = 100;
+
+// Enough for a bulk sender to move data, small enough that one iteration
+// over many of them stays short for everyone else; the command budget only
+// bites on floods of tiny lines
+static const size_t DEFAULT_READ_BUDGET = 16 * 1024;
+static const int DEFAULT_COMMAND_BUDGET = 256;
+
+// Half-registered connections and dead peers are dropped after about this long
+static const int DEFAULT_REGISTER_TIMEOUT = 60;
+static const int DEFAULT_PING_INTERVAL = 120;
+static const int DEFAULT_PING_TIMEOUT = 60;
+
+ServerConfig::ServerConfig()
+    : backend(Poller::BACKEND_EPOLL), sendqLimit(DEFAULT_SENDQ_LIMIT), threads(1),
+      listenBacklog(DEFAULT_LISTEN_BACKLOG), acceptBudget(DEFAULT_ACCEPT_BUDGET), adminPort(0),
+      floodRate(DEFAULT_FLOOD_RATE), floodBurst(DEFAULT_FLOOD_BURST), readBudget(DEFAULT_READ_BUDGET),
+      commandBudget(DEFAULT_COMMAND_BUDGET), recvChunk(RecvPool::DEFAULT_CHUNK_SIZE), registerTimeout(DEFAULT_REGISTER_TIMEOUT),
+      pingInterval(DEFAULT_PING_INTERVAL), pingTimeout(DEFAULT_PING_TIMEOUT), logLevel(Log::LEVEL_INFO)
 {
-    if (_server_fd != -1)
-        close(_server_fd);
-    for (size_t i = 0; i < _poll_fds.size(); ++i)
-        if (_poll_fds[i].fd != -1)
-            close(_poll_fds[i].fd);
 }
 
-void Server::setupSocket()
+// Handlers indexed by CommandId (same order as the enum in Command.hpp)
+const Server::CommandHandler Server::COMMAND_HANDLERS[CMD_COUNT] = {
+    &Server::handlePass,
+    &Server::handleNick,
+    &Server::handleUser,
+    &Server::handleJoin,
+    &Server::handlePart,
+    &Server::handlePrivmsg,
+    &Server::handleNotice,
+    &Server::handleKick,
+    &Server::handleInvite,
+    &Server::handleTopic,
+    &Server::handleNames,
+    &Server::handleMode,
+    &Server::handleQuit,
+    &Server::handlePing,
+    &Server::handlePong
+};
+
+Server::Server(int port, const std::string &password, const ServerConfig &config)
+    : _port(port), _password(password), _config(config), _admin(*this)
 {
-    // Create socket
-    _server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (_server_fd == -1)
-    {
-        std::cerr << "Error: Cannot create socket" << std::endl;
-        exit(1);
-    }
+    Utils::setServerName(SERVER_NAME);
+}
 
-    // Set socket to non-blocking
-    if (fcntl(_server_fd, F_SETFL, O_NONBLOCK) == -1)
+Server::~Server()
+{
+    // IO threads never stop, so only the single-threaded Server gets here
+    if (_reactors.size() == 1)
     {
-        std::cerr << "Error: Cannot set socket to non-blocking" << std::endl;
-        exit(1);
+        std::vector<Client *> clients;
+        _reactors[0]->getClients(clients);
+        for (size_t i = 0; i < clients.size(); ++i)
+        {
+            close(clients[i]->getFd());
+            Client::pool().destroy(clients[i]);
+        }
     }
+    std::vector<Channel *> channels;
+    _channels.values(channels);
+    for (size_t i = 0; i < channels.size(); ++i)
+        Channel::pool().destroy(channels[i]);
+    for (size_t i = 0; i < _reactors.size(); ++i)
+        delete _reactors[i];
+}
+
+void Server::onAccept(Reactor &reactor, int fd, const std::string &hostname)
+{
+    Client *client = Client::pool().create(fd, hostname);
+    reactor.attach(client);
+}
 
-    // Allow port reuse
-    int opt = 1;
-    if (setsockopt(_server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1)
+// Returns false if the client was disconnected and must not be read from
+bool Server::onLine(Client *client, const StringRef &line)
+{
+    // Lines already read after a QUIT are dropped
+    if (client->isDisconnecting())
+        return false;
+    handleLine(client, line);
+
+    // QUIT or a fatal error: stop reading from this client
+    if (client->isDisconnecting())
     {
-        std::cerr << "Error: Cannot set socket options" << std::endl;
-        exit(1);
+        disconnectClient(client);
+        return false;
     }
+    return true;
+}
 
-    // Set up address structure
-    _address.sin_family = AF_INET;
-    _address.sin_addr.s_addr = INADDR_ANY;
-    _address.sin_port = htons(_port);
-    memset(_address.sin_zero, 0, sizeof(_address.sin_zero));
+// The Reactor dropped a line over 512 bytes; the client keeps its connection
+void Server::onLineTooLong(Client *client)
+{
+    if (!client->isDisconnecting())
+        reply(client, IRC::ERR_INPUTTOOLONG, ":Input line was too long");
+}
 
-    // Bind socket
-    if (bind(_server_fd, (struct sockaddr *)&_address, sizeof(_address)) == -1)
+void Server::onHangup(Client *client, const std::string &reason)
+{
+    // Already being dropped (the IO thread noticed before our close request)
+    if (client->isDisconnecting())
+        return;
+    client->markDisconnect(reason);
+    disconnectClient(client);
+}
+
+void Server::disconnectClient(Client *client)
+{
+    // Tell the users sharing a channel, then forget the client everywhere
+    if (client->isRegistered())
+        notifyPeers(client, ":" + client->getPrefix() + " QUIT :" + client->getQuitReason(), false);
+    while (!client->getChannels().empty())
     {
-        std::cerr << "Error: Cannot bind socket" << std::endl;
-        exit(1);
+        Channel *channel = Channel::pool().get(client->getChannels().back());
+        if (channel)
+            leaveChannel(client, channel);
+        else
+            client->removeChannel(client->getChannels().back());
     }
+    StringRef nickname = client->getNickname();
+    if (!nickname.empty() && _nicknames.find(nickname.data, nickname.length) == client)
+        _nicknames.remove(nickname.data, nickname.length);
+    releaseClient(client);
+}
 
-    // Listen for connections
-    if (listen(_server_fd, 10) == -1)
+// Close the client's socket and free it once its Reactor is done with it
+void Server::releaseClient(Client *client)
+{
+    if (client->getOutbox())
     {
-        std::cerr << "Error: Cannot listen on socket" << std::endl;
-        exit(1);
+        // Freed when the IO thread answers with MAIL_FREE
+        client->getOutbox()->post(new Mail(Mail::MAIL_CLOSE, client));
+        return;
     }
+    // Last chance to deliver what is queued (e.g. the ERROR line after QUIT);
+    // freed by onClosed() at the end of the loop iteration
+    _reactors[0]->close(client);
+}
 
-    // Add server socket to poll_fds
-    struct pollfd server_poll_fd;
-    server_poll_fd.fd = _server_fd;
-    server_poll_fd.events = POLLIN;
-    _poll_fds.push_back(server_poll_fd);
-    _client_buffers.push_back(""); // Placeholder for server
+// Tell the client's Reactor it registered, so it stops the registration
+// deadline and starts the keepalive
+void Server::confirmRegistration(Client *client)
+{
+    if (client->getOutbox())
+        client->getOutbox()->post(new Mail(Mail::MAIL_REGISTERED, client));
+    else
+        _reactors[0]->registered(client);
 }
 
-void Server::acceptNewClient()
+void Server::onClosed(Client *client)
 {
-    struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    int client_fd = accept(_server_fd, (struct sockaddr *)&client_addr, &client_len);
-    if (client_fd == -1)
+    Client::pool().destroy(client);
+}
+
+void Server::handleLine(Client *client, const StringRef &line)
+{
+    // Lines that are not valid IRC messages are silently ignored
+    Message message;
+    if (Parser::parse(line, message) != Parser::PARSE_OK)
+        return;
+
+    // Time the command from lookup to the end of its handler
+    CommandId id = Command::lookup(message.getCommand());
+    unsigned long start = Metrics::now();
+    dispatch(client, id, message);
+    Metrics::add(_commands.count[id], 1);
+    _commands.latency[id].record(Metrics::now() - start);
+}
+
+void Server::dispatch(Client *client, CommandId id, const Message &message)
+{
+    // Jump straight to the handler of the command
+    if (id == CMD_UNKNOWN)
     {
-        std::cerr << "Error: Cannot accept client" << std::endl;
+        if (client->isRegistered())
+            reply(client, IRC::ERR_UNKNOWNCOMMAND, message.getCommand().str() + " :Unknown command");
         return;
     }
-
-    // Set client socket to non-blocking
-    if (fcntl(client_fd, F_SETFL, O_NONBLOCK) == -1)
+    if (!client->isRegistered() && !Command::allowedBeforeRegistration(id))
     {
-        std::cerr << "Error: Cannot set client socket to non-blocking" << std::endl;
-        close(client_fd);
+        reply(client, IRC::ERR_NOTREGISTERED, ":You have not registered");
         return;
     }
+    (this->*COMMAND_HANDLERS[id])(client, message);
+}
 
-    // Add client to poll_fds
-    struct pollfd client_poll_fd;
-    client_poll_fd.fd = client_fd;
-    client_poll_fd.events = POLLIN;
-    _poll_fds.push_back(client_poll_fd);
-    _client_buffers.push_back("");
-    std::cout << "New client connected: " << client_fd << std::endl;
+unsigned long Server::getDispatchCount(CommandId id) const
+{
+    return Metrics::read(_commands.count[id]);
+}
+
+// Prometheus text exposition of every metric (called from the admin thread)
+void Server::renderMetrics(std::string &out) const
+{
+    std::vector<const IoMetrics *> loops;
+    for (size_t i = 0; i < _reactors.size(); ++i)
+        loops.push_back(&_reactors[i]->getMetrics());
+    Metrics::writeCommands(out, _commands);
+    Metrics::writeIo(out, loops);
+    Metrics::writeProcess(out);
 }
 
-void Server::handleClient(int client_fd, int index)
+void Server::start()
 {
-    char buffer[1024];
-    int bytes_received = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-    if (bytes_received <= 0)
+    // Log lines are written to stderr by a thread of their own
+    Log::setLevel(_config.logLevel);
+    Log::start(STDERR_FILENO);
+
+    if (_config.threads <= 1)
     {
-        // Client disconnected or error
-        std::cout << "Client disconnected: " << client_fd << std::endl;
-        close(client_fd);
-        _poll_fds.erase(_poll_fds.begin() + index);
-        _client_buffers.erase(_client_buffers.begin() + index);
+        // Default: accept, read, run commands and write on this thread
+        Reactor *reactor = new Reactor(_config, this);
+        _reactors.push_back(reactor);
+        reactor->listen(_port, false);
+        startAdmin();
+        std::cout << "Server listening on port " << _port << " (" << reactor->backendName() << ")" << std::endl;
+        reactor->run();
         return;
     }
 
-    buffer[bytes_received] = '\0';
-    _client_buffers[index] += buffer;
-    std::cout << "Received from " << client_fd << ": " << buffer << std::endl;
-
-    // Echo back to client (simplified, no IRC protocol yet)
-    std::string response = "Server: " + _client_buffers[index];
-    send(client_fd, response.c_str(), response.length(), 0);
-    _client_buffers[index].clear(); // Clear buffer after processing
+    // One Reactor per IO thread, all listening on the port; this thread
+    // becomes the hub that owns every client and channel
+    if (!_hub.open())
+    {
+        std::cerr << "Error: Cannot create hub mailbox" << std::endl;
+        exit(1);
+    }
+    for (int i = 0; i < _config.threads; ++i)
+    {
+        Reactor *reactor = new Reactor(_config, &_hub);
+        _reactors.push_back(reactor);
+        reactor->listen(_port, true);
+    }
+    for (size_t i = 0; i < _reactors.size(); ++i)
+        _reactors[i]->spawn();
+    startAdmin();
+    std::cout << "Server listening on port " << _port << " (" << _reactors[0]->backendName()
+              << ", " << _config.threads << " threads)" << std::endl;
+    runHub();
 }
 
-void Server::start()
+// Serve the metrics on the admin port, once the reactors exist
+void Server::startAdmin()
 {
-    setupSocket();
-    std::cout << "Server listening on port " << _port << std::endl;
+    if (_config.adminPort == 0)
+        return;
+    _admin.listen(_config.adminPort);
+    _admin.spawn();
+    std::cout << "Metrics on http://127.0.0.1:" << _config.adminPort << "/metrics" << std::endl;
+}
 
+// Hub loop: sleep until an IO thread posts mail, then handle all of it
+void Server::runHub()
+{
+    struct pollfd wakeup;
+    wakeup.fd = _hub.wakeupFd();
+    wakeup.events = POLLIN;
     while (true)
     {
-        // Poll for events
-        int poll_count = poll(&_poll_fds[0], _poll_fds.size(), -1);
-        if (poll_count == -1)
+        if (poll(&wakeup, 1, -1) == -1 && errno != EINTR)
         {
             std::cerr << "Error: Poll failed" << std::endl;
             exit(1);
         }
+        processMail();
+    }
+}
 
-        // Check all file descriptors
-        for (size_t i = 0; i < _poll_fds.size(); ++i)
+void Server::processMail()
+{
+    _hub.acknowledge();
+    Mail *mail;
+    while ((mail = _hub.take()) != NULL)
+    {
+        Client *client = mail->client;
+        switch (mail->type)
         {
-            if (_poll_fds[i].revents & POLLIN)
-            {
-                if (_poll_fds[i].fd == _server_fd)
-                {
-                    // New connection
-                    acceptNewClient();
-                }
-                else
-                {
-                    // Client data
-                    handleClient(_poll_fds[i].fd, i);
-                }
-            }
+        case Mail::MAIL_CONNECT:
+            // Create the client here, where its state lives, and hand it back
+            client = Client::pool().create(mail->fd, mail->text);
+            client->setOutbox(mail->replyTo);
+            mail->replyTo->post(new Mail(Mail::MAIL_ATTACH, client));
+            break;
+        case Mail::MAIL_LINE:
+            onLine(client, StringRef(mail->text.data(), mail->text.size()));
+            break;
+        case Mail::MAIL_TOO_LONG:
+            onLineTooLong(client);
+            break;
+        case Mail::MAIL_HANGUP:
+            onHangup(client, mail->text);
+            break;
+        case Mail::MAIL_FREE:
+            Client::pool().destroy(client);
+            break;
+        default:
+            break;
         }
+        delete mail;
     }
-}
\ No newline at end of file
+}
@@ -3,29 +3,120 @@
 
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <poll.h>
+#include <map>
 #include <string>
 #include <vector>
+#include "Poller.hpp"
+#include "Client.hpp"
+#include "Mailbox.hpp"
+#include "Reactor.hpp"
+#include "Command.hpp"
+#include "Parser.hpp"
+#include "Registry.hpp"
+#include "Metrics.hpp"
+#include "AdminServer.hpp"
+#include "Log.hpp"
 
-class Server
+class Channel;
+
+// Name used as the prefix of server replies
+static const char SERVER_NAME[] = "ircserv";
+
+// Tunable settings, filled from the command line
+struct ServerConfig
+{
+    Poller::Backend backend; // Event loop backend
+    size_t sendqLimit;       // Bytes a client may have queued before being dropped
+    int threads;             // IO threads; 1 runs everything on the main thread
+    int listenBacklog;       // Connections the kernel queues before we accept them
+    int acceptBudget;        // Connections a Reactor accepts per loop iteration
+    int adminPort;           // Loopback port serving the metrics; 0 disables it
+    unsigned int floodRate;  // Flood control: command cost units a client earns per second; 0 disables it
+    unsigned int floodBurst; // Flood control: units a client may spend at once
+    size_t readBudget;       // Bytes read from one client per loop iteration; 0: until the socket is drained
+    int commandBudget;       // Lines run for one client per loop iteration; 0: no limit
+    size_t recvChunk;        // Bytes per receive chunk: the longest read, and the input a client can hold
+    int registerTimeout;     // Seconds a connection has to register; 0 disables it
+    int pingInterval;        // Seconds of silence before a client is pinged; 0 disables keepalive
+    int pingTimeout;         // Seconds a pinged client has to answer before it is dropped
+    Log::Level logLevel;     // Lowest level written to stderr
+
+    ServerConfig();
+};
+
+// Owns the IRC state (clients, nicknames, channels) and runs the commands.
+// Sockets are handled by Reactors: one on the main thread by default, or one
+// per IO thread with --threads, in which case the main thread becomes the hub
+// they exchange Mail with.
+class Server : public ReactorHandler
 {
 private:
     int _port;
     std::string _password;
-    int _server_fd; // Server socket file descriptor
-    struct sockaddr_in _address;
-    std::vector<struct pollfd> _poll_fds;     // Vector for poll() file descriptors
-    std::vector<std::string> _client_buffers; // Buffers for client messages
+    ServerConfig _config;
+    std::vector<Reactor *> _reactors;      // Event loops (one per IO thread)
+    Mailbox _hub;                          // Multi-threaded mode: mail from the IO threads
+    Registry<Client> _nicknames;           // Clients by nickname (RFC 1459 case-insensitive)
+    Registry<Channel> _channels;           // Channels by name (RFC 1459 case-insensitive)
+    CommandMetrics _commands;              // Commands dispatched and their latency, per CommandId
+    AdminServer _admin;                    // Serves the metrics to Prometheus
+
+    typedef void (Server::*CommandHandler)(Client *client, const Message &message);
+    static const CommandHandler COMMAND_HANDLERS[CMD_COUNT];
 
 public:
-    Server(int port, const std::string &password);
+    Server(int port, const std::string &password, const ServerConfig &config = ServerConfig());
     ~Server();
     void start();
 
+    virtual void onAccept(Reactor &reactor, int fd, const std::string &hostname);
+    virtual bool onLine(Client *client, const StringRef &line);
+    virtual void onLineTooLong(Client *client);
+    virtual void onHangup(Client *client, const std::string &reason);
+    virtual void onClosed(Client *client);
+    unsigned long getDispatchCount(CommandId id) const;
+    void renderMetrics(std::string &out) const;
+
 private:
-    void setupSocket();
-    void acceptNewClient();
-    void handleClient(int client_fd, int index);
+    Server(const Server &);
+    Server &operator=(const Server &);
+
+    void startAdmin();
+    void runHub();
+    void processMail();
+    void handleLine(Client *client, const StringRef &line);
+    void dispatch(Client *client, CommandId id, const Message &message);
+    void disconnectClient(Client *client);
+    void releaseClient(Client *client);
+    void confirmRegistration(Client *client);
+
+    // Command handlers (ServerCommands.cpp)
+    void handlePass(Client *client, const Message &message);
+    void handleNick(Client *client, const Message &message);
+    void handleUser(Client *client, const Message &message);
+    void handleJoin(Client *client, const Message &message);
+    void handlePart(Client *client, const Message &message);
+    void handlePrivmsg(Client *client, const Message &message);
+    void handleNotice(Client *client, const Message &message);
+    void handleKick(Client *client, const Message &message);
+    void handleInvite(Client *client, const Message &message);
+    void handleTopic(Client *client, const Message &message);
+    void handleNames(Client *client, const Message &message);
+    void handleMode(Client *client, const Message &message);
+    void handleQuit(Client *client, const Message &message);
+    void handlePing(Client *client, const Message &message);
+    void handlePong(Client *client, const Message &message);
+
+    // Helpers shared by the handlers
+    void reply(Client *client, int code, const std::string &message);
+    void reply(Client *client, int code, Payload *body);
+    void tryRegister(Client *client);
+    void sendMessage(Client *client, const Message &message, bool notice);
+    void sendNames(Client *client, Channel *channel);
+    void notifyPeers(Client *client, const std::string &line, bool includeSelf);
+    void leaveChannel(Client *client, Channel *channel);
+    Client *findClient(const std::string &nickname);
+    Channel *findChannel(const std::string &name);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,573 @@
+#include "Server.hpp"
+#include "Client.hpp"
+#include "Channel.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+
+// Take the next item of a comma-separated list (e.g. "#a,#b"); false when done
+static bool nextListItem(StringRef &list, StringRef &item)
+{
+    if (list.empty())
+        return false;
+    const char *comma = static_cast<const char *>(std::memchr(list.data, ',', list.length));
+    size_t length = comma ? static_cast<size_t>(comma - list.data) : list.length;
+    item = StringRef(list.data, length);
+    list = comma ? StringRef(comma + 1, list.length - length - 1) : StringRef();
+    return true;
+}
+
+// Send a numeric reply from the server, addressed to the client's nickname
+void Server::reply(Client *client, int code, const std::string &message)
+{
+    StringRef nick = client->getNickname();
+    Utils::sendReply(client, code, nick.empty() ? StringRef("*", 1) : nick, message);
+}
+
+// Same, with the text taken from a shared payload ending with "\r\n"
+void Server::reply(Client *client, int code, Payload *body)
+{
+    StringRef nick = client->getNickname();
+    Utils::sendReply(client, code, nick.empty() ? StringRef("*", 1) : nick, body);
+}
+
+Client *Server::findClient(const std::string &nickname)
+{
+    return _nicknames.find(nickname);
+}
+
+Channel *Server::findChannel(const std::string &name)
+{
+    return _channels.find(name);
+}
+
+// Send a line once to everyone sharing at least one channel with the client
+void Server::notifyPeers(Client *client, const std::string &line, bool includeSelf)
+{
+    std::vector<Client *> recipients;
+    const std::vector<ChannelHandle> &channels = client->getChannels();
+    for (size_t i = 0; i < channels.size(); ++i)
+    {
+        Channel *channel = Channel::pool().get(channels[i]);
+        if (!channel)
+            continue;
+        const std::vector<ClientHandle> &members = channel->getClients();
+        for (size_t j = 0; j < members.size(); ++j)
+        {
+            Client *member = Client::pool().get(members[j]);
+            if (member)
+                recipients.push_back(member);
+        }
+    }
+    if (includeSelf)
+        recipients.push_back(client);
+    std::sort(recipients.begin(), recipients.end());
+    recipients.erase(std::unique(recipients.begin(), recipients.end()), recipients.end());
+
+    Payload *frame = Payload::createLine(line);
+    for (size_t i = 0; i < recipients.size(); ++i)
+        if (includeSelf || recipients[i] != client)
+            Utils::sendToClient(recipients[i], frame);
+    frame->release();
+}
+
+// Remove the client from a channel, deleting the channel when it becomes empty
+void Server::leaveChannel(Client *client, Channel *channel)
+{
+    channel->removeClient(client);
+    client->removeChannel(channel->getHandle());
+    if (channel->getClientCount() == 0)
+    {
+        _channels.remove(channel->getName());
+        Channel::pool().destroy(channel);
+    }
+}
+
+// RPL_NAMREPLY + RPL_ENDOFNAMES for one channel
+void Server::sendNames(Client *client, Channel *channel)
+{
+    // The channel keeps its names split into lines of at most 512 bytes;
+    // each line's text is referenced, not copied
+    bool listed = false;
+    for (size_t i = 0; i < channel->getNamesChunkCount(); ++i)
+    {
+        Payload *chunk = channel->getNamesChunk(i);
+        if (chunk)
+        {
+            reply(client, IRC::RPL_NAMREPLY, chunk);
+            listed = true;
+        }
+    }
+    if (!listed)
+        reply(client, IRC::RPL_NAMREPLY, "= " + channel->getName() + " :");
+    reply(client, IRC::RPL_ENDOFNAMES, channel->getName() + " :End of /NAMES list");
+}
+
+// Complete registration once PASS, NICK and USER have all been received
+void Server::tryRegister(Client *client)
+{
+    if (client->isRegistered() || client->getNickname().empty() || client->getUsername().empty())
+        return;
+    if (!client->isAuthenticated())
+    {
+        reply(client, IRC::ERR_PASSWDMISMATCH, ":Password incorrect");
+        Utils::sendToClient(client, "ERROR :Closing Link: " + client->getHostname() + " (Bad password)");
+        client->markDisconnect("Bad password");
+        return;
+    }
+
+    client->setRegistered(true);
+    confirmRegistration(client);
+    reply(client, IRC::RPL_WELCOME, ":Welcome to the Internet Relay Network " + client->getPrefix());
+    reply(client, IRC::RPL_YOURHOST, ":Your host is " + std::string(SERVER_NAME) + ", running version 1.0");
+    reply(client, IRC::RPL_CREATED, ":This server was created " + Utils::getTimestamp());
+    reply(client, IRC::RPL_MYINFO, std::string(SERVER_NAME) + " 1.0 o itkolv");
+    client->setWelcomeSent(true);
+}
+
+void Server::handlePass(Client *client, const Message &message)
+{
+    if (client->isRegistered())
+        return reply(client, IRC::ERR_ALREADYREGISTERED, ":You may not reregister");
+    if (message.paramCount < 1)
+        return reply(client, IRC::ERR_NEEDMOREPARAMS, "PASS :Not enough parameters");
+    client->setAuthenticated(message.getParam(0).str() == _password);
+    if (!client->isAuthenticated())
+        reply(client, IRC::ERR_PASSWDMISMATCH, ":Password incorrect");
+}
+
+void Server::handleNick(Client *client, const Message &message)
+{
+    if (message.paramCount < 1 || message.getParam(0).empty())
+        return reply(client, IRC::ERR_NONICKNAMEGIVEN, ":No nickname given");
+    std::string nickname = message.getParam(0).str();
+    if (!Utils::isValidNickname(nickname))
+        return reply(client, IRC::ERR_ERRONEUSNICKNAME, nickname + " :Erroneous nickname");
+
+    Client *owner = findClient(nickname);
+    if (owner && owner != client)
+        return reply(client, IRC::ERR_NICKNAMEINUSE, nickname + " :Nickname is already in use");
+
+    // Announce the change before the prefix changes
+    if (client->isRegistered())
+        notifyPeers(client, ":" + client->getPrefix() + " NICK :" + nickname, true);
+
+    if (client->getNickname().empty())
+        _nicknames.insert(nickname, client);
+    else
+        _nicknames.rename(client->getNickname().str(), nickname);
+    client->setNickname(nickname);
+    const std::vector<ChannelHandle> &channels = client->getChannels();
+    for (size_t i = 0; i < channels.size(); ++i)
+    {
+        Channel *channel = Channel::pool().get(channels[i]);
+        if (channel)
+            channel->updateNickname(client);
+    }
+    tryRegister(client);
+}
+
+void Server::handleUser(Client *client, const Message &message)
+{
+    if (client->isRegistered())
+        return reply(client, IRC::ERR_ALREADYREGISTERED, ":You may not reregister");
+    if (message.paramCount < 4 || message.getParam(0).empty())
+        return reply(client, IRC::ERR_NEEDMOREPARAMS, "USER :Not enough parameters");
+    client->setUsername(message.getParam(0).str());
+    client->setRealname(message.getParam(3).str());
+    tryRegister(client);
+}
+
+void Server::handleJoin(Client *client, const Message &message)
+{
+    if (message.paramCount < 1)
+        return reply(client, IRC::ERR_NEEDMOREPARAMS, "JOIN :Not enough parameters");
+
+    StringRef names = message.getParam(0);
+    StringRef keys = message.getParam(1);
+    StringRef name;
+    while (nextListItem(names, name))
+    {
+        StringRef key;
+        nextListItem(keys, key);
+        std::string channelName = name.str();
+        if (!Utils::isValidChannelName(channelName))
+        {
+            reply(client, IRC::ERR_NOSUCHCHANNEL, channelName + " :No such channel");
+            continue;
+        }
+
+        Channel *channel = findChannel(channelName);
+        if (channel && channel->hasClient(client))
+            continue;
+        if (channel)
+        {
+            if (channel->isInviteOnly() && !channel->isInvited(client))
+            {
+                reply(client, IRC::ERR_INVITEONLYCHAN, channelName + " :Cannot join channel (+i)");
+                continue;
+            }
+            if (channel->hasKey() && key.str() != channel->getKey())
+            {
+                reply(client, IRC::ERR_BADCHANNELKEY, channelName + " :Cannot join channel (+k)");
+                continue;
+            }
+            if (channel->hasUserLimit() && channel->getClientCount() >= channel->getUserLimit())
+            {
+                reply(client, IRC::ERR_CHANNELISFULL, channelName + " :Cannot join channel (+l)");
+                continue;
+            }
+        }
+        else
+        {
+            // The first member creates the channel and becomes its operator
+            channel = Channel::pool().create(channelName);
+            _channels.insert(channelName, channel);
+        }
+
+        channel->addClient(client);
+        channel->removeInvited(client);
+        client->addChannel(channel->getHandle());
+        channel->broadcast(":" + client->getPrefix() + " JOIN " + channel->getName());
+        if (channel->getTopic().empty())
+            reply(client, IRC::RPL_NOTOPIC, channel->getName() + " :No topic is set");
+        else
+            reply(client, IRC::RPL_TOPIC, channel->getName() + " :" + channel->getTopic());
+        sendNames(client, channel);
+    }
+}
+
+void Server::handlePart(Client *client, const Message &message)
+{
+    if (message.paramCount < 1)
+        return reply(client, IRC::ERR_NEEDMOREPARAMS, "PART :Not enough parameters");
+
+    std::string reason = (message.paramCount > 1 ? message.getParam(1) : client->getNickname()).str();
+    StringRef names = message.getParam(0);
+    StringRef name;
+    while (nextListItem(names, name))
+    {
+        Channel *channel = findChannel(name.str());
+        if (!channel)
+        {
+            reply(client, IRC::ERR_NOSUCHCHANNEL, name.str() + " :No such channel");
+            continue;
+        }
+        if (!channel->hasClient(client))
+        {
+            reply(client, IRC::ERR_NOTONCHANNEL, channel->getName() + " :You're not on that channel");
+            continue;
+        }
+        channel->broadcast(":" + client->getPrefix() + " PART " + channel->getName() + " :" + reason);
+        leaveChannel(client, channel);
+    }
+}
+
+// PRIVMSG and NOTICE share the delivery logic; NOTICE never triggers error replies
+void Server::sendMessage(Client *client, const Message &message, bool notice)
+{
+    const char *command = notice ? "NOTICE" : "PRIVMSG";
+    if (message.paramCount < 1 || message.getParam(0).empty())
+    {
+        if (!notice)
+            reply(client, IRC::ERR_NORECIPIENT, std::string(":No recipient given (") + command + ")");
+        return;
+    }
+    if (message.paramCount < 2 || message.getParam(1).empty())
+    {
+        if (!notice)
+            reply(client, IRC::ERR_NOTEXTTOSEND, ":No text to send");
+        return;
+    }
+
+    // A target listed twice (in any case) gets the message once; the last
+    // target needs no remembering, so a single one costs nothing
+    std::vector<Channel *> channelsDone;
+    std::vector<Client *> clientsDone;
+
+    std::string text = message.getParam(1).str();
+    StringRef targets = message.getParam(0);
+    StringRef target;
+    while (nextListItem(targets, target))
+    {
+        std::string name = target.str();
+        if (!name.empty() && name[0] == '#')
+        {
+            Channel *channel = findChannel(name);
+            if (!channel)
+            {
+                if (!notice)
+                    reply(client, IRC::ERR_NOSUCHNICK, name + " :No such nick/channel");
+            }
+            else if (!channel->hasClient(client))
+            {
+                if (!notice)
+                    reply(client, IRC::ERR_CANNOTSENDTOCHAN, name + " :Cannot send to channel");
+            }
+            else if (std::find(channelsDone.begin(), channelsDone.end(), channel) == channelsDone.end())
+            {
+                if (!targets.empty())
+                    channelsDone.push_back(channel);
+                channel->broadcast(":" + client->getPrefix() + " " + command + " " + channel->getName() + " :" + text, client);
+            }
+            continue;
+        }
+
+        Client *recipient = findClient(name);
+        if (!recipient || !recipient->isRegistered())
+        {
+            if (!notice)
+                reply(client, IRC::ERR_NOSUCHNICK, name + " :No such nick/channel");
+            continue;
+        }
+        if (std::find(clientsDone.begin(), clientsDone.end(), recipient) != clientsDone.end())
+            continue;
+        if (!targets.empty())
+            clientsDone.push_back(recipient);
+        Utils::sendToClient(recipient, ":" + client->getPrefix() + " " + command + " " + recipient->getNickname() + " :" + text);
+    }
+}
+
+void Server::handlePrivmsg(Client *client, const Message &message)
+{
+    sendMessage(client, message, false);
+}
+
+void Server::handleNotice(Client *client, const Message &message)
+{
+    sendMessage(client, message, true);
+}
+
+void Server::handleKick(Client *client, const Message &message)
+{
+    if (message.paramCount < 2)
+        return reply(client, IRC::ERR_NEEDMOREPARAMS, "KICK :Not enough parameters");
+
+    std::string channelName = message.getParam(0).str();
+    Channel *channel = findChannel(channelName);
+    if (!channel)
+        return reply(client, IRC::ERR_NOSUCHCHANNEL, channelName + " :No such channel");
+    if (!channel->hasClient(client))
+        return reply(client, IRC::ERR_NOTONCHANNEL, channelName + " :You're not on that channel");
+    if (!channel->isOperator(client))
+        return reply(client, IRC::ERR_CHANOPRIVSNEEDED, channelName + " :You're not channel operator");
+
+    std::string reason = (message.paramCount > 2 ? message.getParam(2) : client->getNickname()).str();
+    StringRef nicks = message.getParam(1);
+    StringRef nick;
+    while (nextListItem(nicks, nick))
+    {
+        Client *target = findClient(nick.str());
+        if (!target || !channel->hasClient(target))
+        {
+            reply(client, IRC::ERR_USERNOTINCHANNEL, nick.str() + " " + channelName + " :They aren't on that channel");
+            continue;
+        }
+        channel->broadcast(":" + client->getPrefix() + " KICK " + channel->getName() + " " + target->getNickname() + " :" + reason);
+        if (target == client)
+            return leaveChannel(target, channel);  // The channel may be gone now
+        leaveChannel(target, channel);
+    }
+}
+
+void Server::handleInvite(Client *client, const Message &message)
+{
+    if (message.paramCount < 2)
+        return reply(client, IRC::ERR_NEEDMOREPARAMS, "INVITE :Not enough parameters");
+
+    std::string nickname = message.getParam(0).str();
+    std::string channelName = message.getParam(1).str();
+    Client *target = findClient(nickname);
+    if (!target || !target->isRegistered())
+        return reply(client, IRC::ERR_NOSUCHNICK, nickname + " :No such nick/channel");
+    Channel *channel = findChannel(channelName);
+    if (!channel)
+        return reply(client, IRC::ERR_NOSUCHCHANNEL, channelName + " :No such channel");
+    if (!channel->hasClient(client))
+        return reply(client, IRC::ERR_NOTONCHANNEL, channelName + " :You're not on that channel");
+    if (channel->isInviteOnly() && !channel->isOperator(client))
+        return reply(client, IRC::ERR_CHANOPRIVSNEEDED, channelName + " :You're not channel operator");
+    if (channel->hasClient(target))
+        return reply(client, IRC::ERR_USERONCHANNEL, nickname + " " + channelName + " :is already on channel");
+
+    channel->addInvited(target);
+    reply(client, IRC::RPL_INVITING, target->getNickname() + " " + channel->getName());
+    Utils::sendToClient(target, ":" + client->getPrefix() + " INVITE " + target->getNickname() + " :" + channel->getName());
+}
+
+void Server::handleTopic(Client *client, const Message &message)
+{
+    if (message.paramCount < 1)
+        return reply(client, IRC::ERR_NEEDMOREPARAMS, "TOPIC :Not enough parameters");
+
+    std::string channelName = message.getParam(0).str();
+    Channel *channel = findChannel(channelName);
+    if (!channel)
+        return reply(client, IRC::ERR_NOSUCHCHANNEL, channelName + " :No such channel");
+    if (!channel->hasClient(client))
+        return reply(client, IRC::ERR_NOTONCHANNEL, channelName + " :You're not on that channel");
+
+    if (message.paramCount < 2)
+    {
+        if (channel->getTopic().empty())
+            return reply(client, IRC::RPL_NOTOPIC, channel->getName() + " :No topic is set");
+        return reply(client, IRC::RPL_TOPIC, channel->getName() + " :" + channel->getTopic());
+    }
+    if (channel->isTopicRestricted() && !channel->isOperator(client))
+        return reply(client, IRC::ERR_CHANOPRIVSNEEDED, channelName + " :You're not channel operator");
+
+    channel->setTopic(message.getParam(1).str());
+    channel->broadcast(":" + client->getPrefix() + " TOPIC " + channel->getName() + " :" + channel->getTopic());
+}
+
+// Served from the channel's cached RPL_NAMREPLY lines. Without a channel only
+// RPL_ENDOFNAMES is sent: listing every channel would be a whole-server dump.
+void Server::handleNames(Client *client, const Message &message)
+{
+    if (message.paramCount < 1)
+        return reply(client, IRC::RPL_ENDOFNAMES, "* :End of /NAMES list");
+
+    StringRef names = message.getParam(0);
+    StringRef name;
+    while (nextListItem(names, name))
+    {
+        Channel *channel = findChannel(name.str());
+        if (channel)
+            sendNames(client, channel);
+        else
+            reply(client, IRC::RPL_ENDOFNAMES, name + " :End of /NAMES list");
+    }
+}
+
+void Server::handleMode(Client *client, const Message &message)
+{
+    if (message.paramCount < 1)
+        return reply(client, IRC::ERR_NEEDMOREPARAMS, "MODE :Not enough parameters");
+
+    std::string targetName = message.getParam(0).str();
+    if (targetName.empty() || targetName[0] != '#')
+    {
+        // User modes are not supported; only report our own (empty) modes
+        if (!CaseMap::equals(targetName, client->getNickname().str()))
+            return reply(client, IRC::ERR_USERSDONTMATCH, ":Cant change mode for other users");
+        return reply(client, IRC::RPL_UMODEIS, "+");
+    }
+
+    Channel *channel = findChannel(targetName);
+    if (!channel)
+        return reply(client, IRC::ERR_NOSUCHCHANNEL, targetName + " :No such channel");
+
+    if (message.paramCount < 2)
+    {
+        std::string modes = channel->getModeString();
+        if (channel->hasKey())
+            modes += " " + channel->getKey();
+        if (channel->hasUserLimit())
+            modes += " " + Utils::intToString(static_cast<int>(channel->getUserLimit()));
+        return reply(client, IRC::RPL_CHANNELMODEIS, channel->getName() + " " + (modes.empty() ? "+" : modes));
+    }
+    if (!channel->isOperator(client))
+        return reply(client, IRC::ERR_CHANOPRIVSNEEDED, channel->getName() + " :You're not channel operator");
+
+    // Apply each mode letter, collecting what actually changed for the broadcast
+    StringRef modes = message.getParam(1);
+    unsigned int nextArg = 2;
+    bool adding = true;
+    char appliedSign = 0;
+    std::string applied;
+    std::string appliedArgs;
+    for (size_t i = 0; i < modes.length; ++i)
+    {
+        char mode = modes[i];
+        if (mode == '+' || mode == '-')
+        {
+            adding = (mode == '+');
+            continue;
+        }
+
+        std::string arg;
+        bool needsArg = (mode == 'k' && adding) || mode == 'o' || mode == 'v' || (mode == 'l' && adding);
+        if (needsArg)
+        {
+            if (nextArg >= message.paramCount)
+            {
+                reply(client, IRC::ERR_NEEDMOREPARAMS, "MODE :Not enough parameters");
+                continue;
+            }
+            arg = message.getParam(nextArg++).str();
+        }
+
+        if (mode == 'i')
+            channel->setInviteOnly(adding);
+        else if (mode == 't')
+            channel->setTopicRestricted(adding);
+        else if (mode == 'k' && adding)
+            channel->setKey(arg);
+        else if (mode == 'k')
+            channel->removeKey();
+        else if (mode == 'l' && adding)
+        {
+            int limit;
+            if (!Utils::stringToInt(arg, limit) || limit <= 0)
+                continue;
+            channel->setUserLimit(static_cast<size_t>(limit));
+        }
+        else if (mode == 'l')
+            channel->removeUserLimit();
+        else if (mode == 'o' || mode == 'v')
+        {
+            Client *target = findClient(arg);
+            if (!target || !channel->hasClient(target))
+            {
+                reply(client, IRC::ERR_USERNOTINCHANNEL, arg + " " + channel->getName() + " :They aren't on that channel");
+                continue;
+            }
+            if (mode == 'o' && adding)
+                channel->addOperator(target);
+            else if (mode == 'o')
+                channel->removeOperator(target);
+            else if (adding)
+                channel->addVoice(target);
+            else
+                channel->removeVoice(target);
+            arg = target->getNickname().str();
+        }
+        else
+        {
+            reply(client, IRC::ERR_UNKNOWNMODE, std::string(1, mode) + " :is unknown mode char to me for " + channel->getName());
+            continue;
+        }
+
+        char sign = adding ? '+' : '-';
+        if (sign != appliedSign)
+        {
+            applied += sign;
+            appliedSign = sign;
+        }
+        applied += mode;
+        if (!arg.empty())
+            appliedArgs += " " + arg;
+    }
+
+    if (!applied.empty())
+        channel->broadcast(":" + client->getPrefix() + " MODE " + channel->getName() + " " + applied + appliedArgs);
+}
+
+void Server::handleQuit(Client *client, const Message &message)
+{
+    std::string reason = message.paramCount > 0 ? "Quit: " + message.getParam(0).str() : "Client Quit";
+    Utils::sendToClient(client, "ERROR :Closing Link: " + client->getHostname() + " (" + reason + ")");
+    client->markDisconnect(reason);
+}
+
+void Server::handlePing(Client *client, const Message &message)
+{
+    if (message.paramCount < 1)
+        return reply(client, IRC::ERR_NOORIGIN, ":No origin specified");
+    Utils::sendToClient(client, std::string(":") + SERVER_NAME + " PONG " + SERVER_NAME + " :" + message.getParam(0).str());
+}
+
+// Answer to the keepalive PING: the Reactor already counted the client as
+// alive when it read the line, so there is nothing left to do
+void Server::handlePong(Client *, const Message &)
+{
+}
@@ -1,12 +1,116 @@
 #include "Server.hpp"
+#include <csignal>
 #include <cstdlib>
 #include <iostream>
 
+// Parse one --name=value option into the config. Returns false if invalid.
+static bool parseOption(const std::string &option, ServerConfig &config)
+{
+    size_t equal = option.find('=');
+    if (option.compare(0, 2, "--") != 0 || equal == std::string::npos)
+        return false;
+    std::string name = option.substr(2, equal - 2);
+    std::string value = option.substr(equal + 1);
+
+    if (name == "backend")
+        return Poller::parseBackend(value, config.backend);
+    if (name == "sendq")
+    {
+        char *end;
+        unsigned long bytes = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || bytes == 0)
+            return false;
+        config.sendqLimit = bytes;
+        return true;
+    }
+    if (name == "threads")
+    {
+        char *end;
+        long threads = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || threads < 1 || threads > 64)
+            return false;
+        config.threads = static_cast<int>(threads);
+        return true;
+    }
+    if (name == "backlog" || name == "accept-budget")
+    {
+        char *end;
+        long count = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || count < 1 || count > 65535)
+            return false;
+        (name == "backlog" ? config.listenBacklog : config.acceptBudget) = static_cast<int>(count);
+        return true;
+    }
+    if (name == "flood-rate" || name == "flood-burst")
+    {
+        char *end;
+        long units = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || units < 0 || units > 1000000)
+            return false;
+        // The burst must cover the most expensive command, or it would never run
+        if (name == "flood-burst" && units < static_cast<long>(Command::MAX_COST))
+            return false;
+        (name == "flood-rate" ? config.floodRate : config.floodBurst) = static_cast<unsigned int>(units);
+        return true;
+    }
+    if (name == "read-budget" || name == "command-budget")
+    {
+        char *end;
+        long amount = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || amount < 0 || amount > 1000000000)
+            return false;
+        if (name == "read-budget")
+            config.readBudget = static_cast<size_t>(amount);
+        else
+            config.commandBudget = static_cast<int>(amount);
+        return true;
+    }
+    if (name == "recv-chunk")
+    {
+        char *end;
+        long bytes = std::strtol(value.c_str(), &end, 10);
+        // A chunk must hold an unfinished line and still have room to read
+        if (value.empty() || *end != '\0' || bytes < 1024 || bytes > 1048576)
+            return false;
+        config.recvChunk = static_cast<size_t>(bytes);
+        return true;
+    }
+    if (name == "register-timeout" || name == "ping-interval" || name == "ping-timeout")
+    {
+        char *end;
+        long seconds = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || seconds < 0 || seconds > 86400)
+            return false;
+        if (name == "ping-timeout" && seconds == 0)
+            return false;
+        (name == "register-timeout" ? config.registerTimeout
+         : name == "ping-interval"  ? config.pingInterval
+                                    : config.pingTimeout) = static_cast<int>(seconds);
+        return true;
+    }
+    if (name == "log")
+        return Log::parseLevel(value, config.logLevel);
+    if (name == "admin")
+    {
+        char *end;
+        long port = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || port < 1 || port > 65535)
+            return false;
+        config.adminPort = static_cast<int>(port);
+        return true;
+    }
+    return false;
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 3)
+    if (argc < 3)
     {
-        std::cerr << "Usage: ./ircserv <port> <password>" << std::endl;
+        std::cerr << "Usage: ./ircserv <port> <password> [--backend=epoll|poll|io_uring] [--sendq=bytes] [--threads=n]"
+                  << " [--backlog=n] [--accept-budget=n] [--admin=port] [--log=debug|info|warn|error]"
+                  << " [--flood-rate=units] [--flood-burst=units] [--register-timeout=s] [--ping-interval=s]"
+                  << " [--ping-timeout=s] [--read-budget=bytes] [--command-budget=n] [--recv-chunk=bytes]"
+                  << std::endl;
         return 1;
     }
 
@@ -24,7 +128,21 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    Server server(port, password);
+    // Optional settings: --name=value
+    ServerConfig config;
+    for (int i = 3; i < argc; ++i)
+    {
+        if (!parseOption(argv[i], config))
+        {
+            std::cerr << "Error: Invalid option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // A peer closing its socket must not kill the server while we write to it
+    signal(SIGPIPE, SIG_IGN);
+
+    Server server(port, password, config);
     server.start();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+/**
+ * @brief Tests for the NAMES command and the channel's cached reply
+ *
+ * Drives a Server in-process the way the hub does in multi-threaded mode:
+ * each client's outbox is a Mailbox owned by the test, so everything the
+ * server sends arrives as MAIL_OUTPUT and no socket or Reactor is needed.
+ *
+ * Usage: ./test_names (exits non-zero on the first failed check)
+ */
+#include "Server.hpp"
+#include "Client.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static void check(bool condition, const char* what, const std::string& output) {
+    if (condition)
+        return;
+    fprintf(stderr, "check failed: %s\noutput:\n%s", what, output.c_str());
+    exit(1);
+}
+
+static bool contains(const std::string& output, const std::string& line) {
+    return output.find(line + "\r\n") != std::string::npos;
+}
+
+/**
+ * @brief Everything the server has sent since the last call, in order
+ */
+static std::string drain(Mailbox& outbox) {
+    std::string output;
+    Mail* mail;
+    while ((mail = outbox.take()) != NULL) {
+        if (mail->type == Mail::MAIL_OUTPUT) {
+            output.append(mail->payload->data(), mail->payload->length());
+            mail->payload->release();
+        }
+        delete mail;
+    }
+    return output;
+}
+
+static void send(Server& server, Client* client, const std::string& line) {
+    server.onLine(client, StringRef(line.data(), line.size()));
+}
+
+static Client* connect(Server& server, Mailbox& outbox, const std::string& nick) {
+    Client* client = Client::pool().create(-1, "127.0.0.1");
+    client->setOutbox(&outbox);
+    send(server, client, "PASS pw");
+    send(server, client, "NICK " + nick);
+    send(server, client, "USER " + nick + " 0 * :" + nick);
+    return client;
+}
+
+int main() {
+    Mailbox outbox;
+    check(outbox.open(), "mailbox", "");
+    {
+        Server server(0, "pw");
+        Client* alice = connect(server, outbox, "alice");
+        Client* bob = connect(server, outbox, "bob");
+        send(server, alice, "JOIN #chan");
+        send(server, bob, "JOIN #chan");
+        drain(outbox);
+
+        // Served from the cache, by any client
+        send(server, bob, "NAMES #chan");
+        std::string output = drain(outbox);
+        check(contains(output, ":ircserv 353 bob = #chan :@alice bob"), "names before MODE", output);
+        check(contains(output, ":ircserv 366 bob #chan :End of /NAMES list"), "end of names", output);
+
+        // A mode change must refresh the cached chunk
+        send(server, alice, "MODE #chan +o bob");
+        drain(outbox);
+        send(server, bob, "names #CHAN");
+        output = drain(outbox);
+        check(contains(output, ":ircserv 353 bob = #chan :@alice @bob"), "names after MODE +o", output);
+
+        send(server, alice, "MODE #chan -o alice");
+        drain(outbox);
+        send(server, alice, "NAMES #chan,#missing");
+        output = drain(outbox);
+        check(contains(output, ":ircserv 353 alice = #chan :@bob alice"), "names after MODE -o", output);
+        check(contains(output, ":ircserv 366 alice #missing :End of /NAMES list"), "unknown channel", output);
+
+        send(server, alice, "NAMES");
+        output = drain(outbox);
+        check(output == ":ircserv 366 alice * :End of /NAMES list\r\n", "names without a channel", output);
+        check(server.getDispatchCount(CMD_NAMES) == 4, "dispatch count", output);
+
+        Client::pool().destroy(alice);
+        Client::pool().destroy(bob);
+    }
+    drain(outbox);
+    printf("test_names: ok\n");
+    return 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * @brief Tests for TimerWheel
+ *
+ * Usage: ./test_timer_wheel (exits non-zero on the first failed check)
+ */
+#include "TimerWheel.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const unsigned long TICK_MS = 100;
+static const unsigned long MINUTE = 60 * 1000UL;
+static const unsigned long DAY = 24 * 60 * MINUTE;
+
+static void check(bool condition, const char* what) {
+    if (condition)
+        return;
+    fprintf(stderr, "check failed: %s\n", what);
+    exit(1);
+}
+
+// A deadline scheduled right after a long idle period is relative to now,
+// not to the tick the wheel was at when it last had a timer
+static void testIdleGap() {
+    std::vector<Timer*> expired;
+    TimerWheel wheel(0, TICK_MS);
+    Timer timer;
+    wheel.schedule(timer, MINUTE);
+    wheel.advance(MINUTE, expired);
+    check(expired.size() == 1 && wheel.size() == 0, "first timer fires");
+    expired.clear();
+
+    // Longer than the wheel's span (about 19 days), with nothing pending
+    unsigned long now = MINUTE + 30 * DAY;
+    wheel.advance(now, expired);
+    check(expired.empty(), "idle advance");
+
+    wheel.schedule(timer, now + MINUTE);
+    check(wheel.nextExpiry() <= now + MINUTE && wheel.nextExpiry() > now, "next expiry after the gap");
+    wheel.advance(now + MINUTE - TICK_MS, expired);
+    check(expired.empty() && timer.pending, "not due before its deadline");
+    wheel.advance(now + MINUTE, expired);
+    check(expired.size() == 1 && expired[0] == &timer && !timer.pending, "due at its deadline");
+}
+
+// Timers on different levels fire in order, and a cancelled one never does
+static void testCascade() {
+    std::vector<Timer*> expired;
+    TimerWheel wheel(0, TICK_MS);
+    Timer soon, later, cancelled;
+    wheel.schedule(soon, 500);
+    wheel.schedule(later, 10 * MINUTE);
+    wheel.schedule(cancelled, 5 * MINUTE);
+    wheel.cancel(cancelled);
+    check(wheel.size() == 2, "two pending");
+
+    wheel.advance(MINUTE, expired);
+    check(expired.size() == 1 && expired[0] == &soon, "soon fires first");
+    expired.clear();
+    wheel.advance(10 * MINUTE - TICK_MS, expired);
+    check(expired.empty(), "later not due yet");
+    wheel.advance(10 * MINUTE, expired);
+    check(expired.size() == 1 && expired[0] == &later && wheel.size() == 0, "later fires after cascading");
+}
+
+int main() {
+    testIdleGap();
+    testCascade();
+    printf("test_timer_wheel: ok\n");
+    return 0;
+}